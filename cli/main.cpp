@@ -0,0 +1,345 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Search.h"
+
+
+// Command line driver of the search engine, which runs an exhaustive search
+// without R. The data is read from a CSV file or a binary matrix file and the
+// final ranking is written as CSV.
+
+const char* M_USAGE =
+  "Usage: exhaustive-search [options] DATA\n"
+  "\n"
+  "DATA is a CSV file with a header line and numeric columns, or a binary\n"
+  "matrix file (*.bin): the 8 bytes 'ESMATRIX', the number of rows and of\n"
+  "columns (uint64), and all values column by column (double). The columns\n"
+  "of a binary file are named V1, V2, ...\n"
+  "\n"
+  "Options:\n"
+  "  --response NAME        response column (default: the first column)\n"
+  "  --test FILE            test data in the same format as DATA\n"
+  "  --family NAME          'gaussian', 'binomial', 'poisson' or 'Gamma'\n"
+  "                         (default: 'gaussian' or 'binomial' guessed from\n"
+  "                         the response)\n"
+  "  --measure NAME         'AIC' or 'MSE' (default: 'MSE' with test data,\n"
+  "                         'AIC' otherwise)\n"
+  "  --no-intercept         fit models without intercept\n"
+  "  --combs-up-to K        maximum number of features per model\n"
+  "  --results N            size of the ranking (default: 5000)\n"
+  "  --threads N            number of threads (default: all)\n"
+  "  --backend NAME         'threads' or 'openmp' (default: 'threads')\n"
+  "  --pin-threads          bind the threads to CPUs, with a copy of the data\n"
+  "                         per NUMA node\n"
+  "  --enumeration NAME     'sizeFirst', 'depthFirst' or 'revolvingDoor'\n"
+  "  --rank-range FROM:TO   only evaluate the ranks FROM, ..., TO - 1\n"
+  "  --checkpoint FILE      save the state of the search regularly\n"
+  "  --checkpoint-interval SEC\n"
+  "                         seconds between checkpoints (default: 600)\n"
+  "  --resume               continue from the checkpoint file\n"
+  "  --pruning              skip models that cannot enter the ranking\n"
+  "  --result-file BASE     write every model to BASE.<thread>\n"
+  "  --batch-costs NAME     'fixed', 'pilot' or 'count'\n"
+  "  --output FILE          write the ranking to FILE (default: stdout)\n"
+  "  --quiet                do not print the progress\n";
+
+
+// A data set with named columns, stored column by column like arma::mat
+struct Table {
+  size_t nRows;
+  std::vector<std::string> names;
+  std::vector<double> values;
+  const double* column(size_t j) const { return &values[j * nRows]; }
+};
+
+
+std::vector<std::string> splitCsvLine(const std::string& line) {
+
+  std::vector<std::string> fields;
+  std::string field;
+  bool quoted = false;
+  for (char c : line) {
+    if (c == '"') quoted = !quoted;
+    else if (c == ',' && !quoted) {
+      fields.push_back(field);
+      field.clear();
+    } else if (c != '\r') field += c;
+  }
+  fields.push_back(field);
+  return fields;
+}
+
+
+Table readCsv(const std::string& file) {
+
+  std::ifstream in(file.c_str());
+  if (!in) throw std::runtime_error("Cannot open " + file + ".");
+
+  Table table;
+  std::string line;
+  if (!std::getline(in, line))
+    throw std::runtime_error(file + " has no header line.");
+  table.names = splitCsvLine(line);
+  size_t nCols = table.names.size();
+
+  // The rows are read first, as the columns are stored contiguously
+  std::vector<double> rows;
+  size_t lineNo = 1;
+  while (std::getline(in, line)) {
+    lineNo++;
+    if (line.empty() || line == "\r") continue;
+    std::vector<std::string> fields = splitCsvLine(line);
+    if (fields.size() != nCols) throw std::runtime_error(file + ", line " +
+      std::to_string(lineNo) + ": expected " + std::to_string(nCols) +
+      " fields.");
+    for (const std::string& field : fields) {
+      char* end = NULL;
+      double value = strtod(field.c_str(), &end);
+      if (field.empty() || *end != '\0') throw std::runtime_error(file +
+        ", line " + std::to_string(lineNo) + ": '" + field +
+        "' is not a number.");
+      rows.push_back(value);
+    }
+  }
+
+  table.nRows = rows.size() / nCols;
+  table.values.resize(rows.size());
+  for (size_t i = 0; i < table.nRows; i++)
+    for (size_t j = 0; j < nCols; j++)
+      table.values[j * table.nRows + i] = rows[i * nCols + j];
+  return table;
+}
+
+
+Table readBinary(const std::string& file) {
+
+  std::ifstream in(file.c_str(), std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open " + file + ".");
+
+  char magic[8];
+  uint64_t nRows = 0, nCols = 0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&nRows), sizeof(nRows));
+  in.read(reinterpret_cast<char*>(&nCols), sizeof(nCols));
+  if (!in || std::string(magic, sizeof(magic)) != "ESMATRIX")
+    throw std::runtime_error(file + " is not a binary matrix file.");
+
+  Table table;
+  table.nRows = nRows;
+  for (uint64_t j = 0; j < nCols; j++)
+    table.names.push_back("V" + std::to_string(j + 1));
+  table.values.resize(nRows * nCols);
+  in.read(reinterpret_cast<char*>(table.values.data()),
+    table.values.size() * sizeof(double));
+  if (!in) throw std::runtime_error(file + " is truncated.");
+  return table;
+}
+
+
+Table readTable(const std::string& file) {
+  bool binary = file.size() > 4 && file.substr(file.size() - 4) == ".bin";
+  return binary ? readBinary(file) : readCsv(file);
+}
+
+
+// Splits a table into the design matrix (see DataSet.h) and the response. Like
+// in R, column 0 is the intercept, or an unused dummy column without intercept.
+void designMatrix(const Table& table, size_t response, bool intercept,
+  arma::mat& X, std::vector<double>& y) {
+
+  size_t nFeatures = table.names.size() - 1;
+  X.set_size(table.nRows, nFeatures + 1);
+  X.col(0).fill(intercept ? 1.0 : 0.0);
+  for (size_t j = 0, col = 1; j < table.names.size(); j++) {
+    if (j == response) continue;
+    std::copy(table.column(j), table.column(j) + table.nRows, X.colptr(col++));
+  }
+  y.assign(table.column(response), table.column(response) + table.nRows);
+}
+
+
+int main(int argc, char** argv) {
+
+  try {
+    SearchSetup setup;
+    std::string dataFile, testFile, responseName, outputFile;
+    bool familySet = false, measureSet = false, combsUpToSet = false,
+      enumerationSet = false;
+
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      auto value = [&]() -> std::string {
+        if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value.");
+        return argv[++i];
+      };
+      auto number = [&]() -> double {
+        std::string text = value();
+        char* end = NULL;
+        double x = strtod(text.c_str(), &end);
+        if (text.empty() || *end != '\0' || x < 0)
+          throw std::invalid_argument(arg + " needs a number >= 0.");
+        return x;
+      };
+
+      if (arg == "--help" || arg == "-h") {
+        std::cout << M_USAGE;
+        return 0;
+      }
+      else if (arg == "--response") responseName = value();
+      else if (arg == "--test") testFile = value();
+      else if (arg == "--family") {
+        setup.family = value();
+        familySet = true;
+      }
+      else if (arg == "--measure") {
+        setup.performanceMeasure = value();
+        measureSet = true;
+      }
+      else if (arg == "--no-intercept") setup.intercept = false;
+      else if (arg == "--combs-up-to") {
+        setup.combsUpTo = (uint)number();
+        combsUpToSet = true;
+      }
+      else if (arg == "--results") setup.nResults = (size_t)number();
+      else if (arg == "--threads") setup.nThreads = (size_t)number();
+      else if (arg == "--backend") {
+        std::string name = value();
+        if (name == "threads") setup.backend = THREADS;
+        else if (name == "openmp") setup.backend = OPENMP;
+        else throw std::invalid_argument("Unknown backend " + name + ".");
+      }
+      else if (arg == "--pin-threads") setup.pinThreads = true;
+      else if (arg == "--enumeration") {
+        std::string name = value();
+        if (name == "sizeFirst") setup.order = SIZE_FIRST;
+        else if (name == "depthFirst") setup.order = DEPTH_FIRST;
+        else if (name == "revolvingDoor") setup.order = REVOLVING_DOOR;
+        else throw std::invalid_argument("Unknown enumeration " + name + ".");
+        enumerationSet = true;
+      }
+      else if (arg == "--rank-range") {
+        std::string range = value();
+        size_t sep = range.find(':');
+        if (sep == std::string::npos)
+          throw std::invalid_argument("--rank-range needs FROM:TO.");
+        setup.rankStart = std::stoull(range.substr(0, sep));
+        setup.rankEnd = std::stoull(range.substr(sep + 1));
+      }
+      else if (arg == "--checkpoint") setup.checkpointFile = value();
+      else if (arg == "--checkpoint-interval")
+        setup.checkpointInterval = (size_t)number();
+      else if (arg == "--resume") setup.resume = true;
+      else if (arg == "--pruning") setup.pruning = true;
+      else if (arg == "--result-file") setup.resultFile = value();
+      else if (arg == "--batch-costs") setup.batchCosts = value();
+      else if (arg == "--output") outputFile = value();
+      else if (arg == "--quiet") setup.quietly = true;
+      else if (!arg.empty() && arg[0] == '-')
+        throw std::invalid_argument("Unknown option " + arg + ".");
+      else if (dataFile.empty()) dataFile = arg;
+      else throw std::invalid_argument("Only one data file can be given.");
+    }
+    if (dataFile.empty()) {
+      std::cerr << M_USAGE;
+      return 1;
+    }
+
+    // Read the data and split off the response column
+    Table data = readTable(dataFile);
+    if (data.names.size() < 2 || data.nRows == 0)
+      throw std::runtime_error(dataFile + " needs a response, a feature and " +
+        "at least one row.");
+    size_t response = 0;
+    if (!responseName.empty()) {
+      response = std::find(data.names.begin(), data.names.end(),
+        responseName) - data.names.begin();
+      if (response == data.names.size())
+        throw std::invalid_argument("No column " + responseName + ".");
+    }
+    std::vector<std::string> features;
+    for (size_t j = 0; j < data.names.size(); j++)
+      if (j != response) features.push_back(data.names[j]);
+
+    arma::mat X, XTest(0, data.names.size());
+    std::vector<double> y, yTest;
+    designMatrix(data, response, setup.intercept, X, y);
+    if (!testFile.empty()) {
+      Table test = readTable(testFile);
+      if (test.names != data.names) throw std::runtime_error(testFile +
+        " needs the same columns as " + dataFile + ".");
+      designMatrix(test, response, setup.intercept, XTest, yTest);
+    }
+
+    // The same defaults as in R
+    bool binary = std::set<double>(y.begin(), y.end()).size() == 2;
+    if (!familySet) {
+      setup.family = binary ? "binomial" : "gaussian";
+      std::cerr << "Family not specified, assuming '" << setup.family << "'."
+        << std::endl;
+    }
+    if (!measureSet) setup.performanceMeasure = testFile.empty() ? "AIC" :
+      "MSE";
+    if (!combsUpToSet || setup.combsUpTo > features.size())
+      setup.combsUpTo = features.size();
+    if (setup.combsUpTo == 0)
+      throw std::invalid_argument("--combs-up-to needs to be > 0.");
+    if (setup.batchCosts != "fixed" && setup.batchCosts != "pilot" &&
+      setup.batchCosts != "count")
+      throw std::invalid_argument("Unknown batch costs " + setup.batchCosts +
+        ".");
+    if (setup.pruning) {
+      if (enumerationSet && setup.order != DEPTH_FIRST)
+        throw std::invalid_argument("--pruning needs depthFirst enumeration.");
+      if (!setup.resultFile.empty())
+        throw std::invalid_argument("--pruning cannot be combined with "
+          "--result-file, as pruned models are not written.");
+      setup.order = DEPTH_FIRST;
+    }
+
+    installInterruptHandler();
+    SearchResult result = runExhaustiveSearch(X, y, XTest, yTest, setup);
+
+    // The ranking is written like resultTable() in R
+    std::ofstream file;
+    if (!outputFile.empty()) {
+      file.open(outputFile.c_str());
+      if (!file) throw std::runtime_error("Cannot open " + outputFile + ".");
+    }
+    std::ostream& out = outputFile.empty() ? std::cout : file;
+    out.precision(17);
+    out << setup.performanceMeasure << ",Combination\n";
+    for (size_t i = 0; i < result.performance.size(); i++) {
+      out << result.performance[i] << ",\"";
+      for (size_t j = 0; j < result.combinations[i].size(); j++)
+        out << (j > 0 ? " + " : "") << features[result.combinations[i][j] - 1];
+      out << "\"\n";
+    }
+    out.flush();
+    if (!out) throw std::runtime_error("Writing the ranking failed.");
+
+    for (const std::string& resultFile : result.resultFiles)
+      std::cerr << "Result file: " << resultFile << std::endl;
+
+    Combination Comb(features.size(), setup.combsUpTo, 0, setup.order);
+    size_t nModels = std::min(setup.rankEnd, Comb.getNCombinations()) -
+      setup.rankStart;
+    if (result.nModels != nModels) {
+      std::cerr << "Evaluation incomplete! Only " << result.nModels << " of "
+        << nModels << " models were evaluated." << std::endl;
+      return 2;
+    }
+    return 0;
+
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+}
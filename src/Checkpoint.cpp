@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "Checkpoint.h"
+
+
+// File layout (native byte order): magic, version, the setup fields, the
+// runtime, the size costs, one byte per chunk and the (score, rank) pairs of
+// the ranking.
+static const char M_MAGIC[8] = {'E', 'S', 'C', 'H', 'E', 'C', 'K', 'P'};
+static const uint32_t M_VERSION = 3;
+
+
+template <class T>
+static void writeValue(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+static void readValue(std::ifstream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+static void writeString(std::ofstream& out, const std::string& s) {
+  writeValue(out, (uint32_t)s.size());
+  out.write(s.data(), s.size());
+}
+
+static void readString(std::ifstream& in, std::string& s) {
+  uint32_t size = 0;
+  readValue(in, size);
+  if (!in || size > 1024) return;
+  s.resize(size);
+  in.read(&s[0], size);
+}
+
+
+uint64_t dataChecksum(uint64_t hash, const double* values, size_t n) {
+
+  if (hash == 0) hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t bits;
+    std::memcpy(&bits, &values[i], sizeof(bits));
+    hash = (hash ^ bits) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+
+bool Checkpoint::matches(const Checkpoint& other) const {
+  return family == other.family &&
+    performanceMeasure == other.performanceMeasure &&
+    intercept == other.intercept &&
+    (errorVal == other.errorVal ||
+      (std::isnan(errorVal) && std::isnan(other.errorVal))) &&
+    dataChecksum == other.dataChecksum &&
+    nFeatures == other.nFeatures && combsUpTo == other.combsUpTo &&
+    order == other.order && nTrain == other.nTrain && nTest == other.nTest &&
+    nResults == other.nResults && rankStart == other.rankStart &&
+    rankEnd == other.rankEnd;
+}
+
+
+void Checkpoint::write(const std::string& file) const {
+
+  std::string tmpFile = file + ".tmp";
+  {
+    std::ofstream out(tmpFile.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot write checkpoint " + tmpFile);
+
+    out.write(M_MAGIC, sizeof(M_MAGIC));
+    writeValue(out, M_VERSION);
+    writeString(out, family);
+    writeString(out, performanceMeasure);
+    writeValue(out, intercept);
+    writeValue(out, errorVal);
+    writeValue(out, dataChecksum);
+    writeValue(out, nFeatures);
+    writeValue(out, combsUpTo);
+    writeValue(out, order);
+    writeValue(out, nTrain);
+    writeValue(out, nTest);
+    writeValue(out, nResults);
+    writeValue(out, rankStart);
+    writeValue(out, rankEnd);
+    writeValue(out, nChunks);
+    writeValue(out, runtimeSec);
+    writeValue(out, (uint32_t)sizeCosts.size());
+    for (double cost : sizeCosts) writeValue(out, cost);
+    out.write(chunkDone.data(), chunkDone.size());
+    writeValue(out, (uint64_t)entries.size());
+    for (const std::pair<double, uint64_t>& entry : entries) {
+      writeValue(out, entry.first);
+      writeValue(out, entry.second);
+    }
+    out.flush();
+    if (!out) throw std::runtime_error("Cannot write checkpoint " + tmpFile);
+  }
+
+  // rename() does not replace an existing file on every platform
+  if (std::rename(tmpFile.c_str(), file.c_str()) != 0) {
+    std::remove(file.c_str());
+    if (std::rename(tmpFile.c_str(), file.c_str()) != 0)
+      throw std::runtime_error("Cannot write checkpoint " + file);
+  }
+}
+
+
+void Checkpoint::read(const std::string& file) {
+
+  std::ifstream in(file.c_str(), std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot read checkpoint " + file);
+
+  char magic[sizeof(M_MAGIC)];
+  uint32_t version = 0;
+  in.read(magic, sizeof(M_MAGIC));
+  readValue(in, version);
+  if (!in || !std::equal(magic, magic + sizeof(M_MAGIC), M_MAGIC) ||
+    version != M_VERSION)
+    throw std::runtime_error(file + " is not a valid checkpoint file.");
+
+  readString(in, family);
+  readString(in, performanceMeasure);
+  readValue(in, intercept);
+  readValue(in, errorVal);
+  readValue(in, dataChecksum);
+  readValue(in, nFeatures);
+  readValue(in, combsUpTo);
+  readValue(in, order);
+  readValue(in, nTrain);
+  readValue(in, nTest);
+  readValue(in, nResults);
+  readValue(in, rankStart);
+  readValue(in, rankEnd);
+  readValue(in, nChunks);
+  readValue(in, runtimeSec);
+  uint32_t nSizeCosts = 0;
+  readValue(in, nSizeCosts);
+  if (!in || nChunks > UINT32_MAX || nSizeCosts > combsUpTo + 1)
+    throw std::runtime_error("Checkpoint " + file + " is corrupt.");
+
+  sizeCosts.resize(nSizeCosts);
+  for (double& cost : sizeCosts) readValue(in, cost);
+
+  chunkDone.resize(nChunks);
+  in.read(chunkDone.data(), nChunks);
+  uint64_t nEntries = 0;
+  readValue(in, nEntries);
+  if (!in || nEntries > nResults)
+    throw std::runtime_error("Checkpoint " + file + " is corrupt.");
+  entries.resize(nEntries);
+  for (std::pair<double, uint64_t>& entry : entries) {
+    readValue(in, entry.first);
+    readValue(in, entry.second);
+  }
+  if (!in) throw std::runtime_error("Checkpoint " + file + " is corrupt.");
+}
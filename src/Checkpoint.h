@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// A Checkpoint is the state of an interrupted search: which chunks (see
+// Combination::getBatchStarts()) are completed and the best models found in
+// them. Models are stored by their rank in the enumeration order, which keeps
+// the file small and independent of the combination size.
+//
+// The setup fields identify the search. A checkpoint can only be resumed by a
+// search with the same setup, as ranks and chunks refer to it. The data is
+// identified by a checksum of its values (see dataChecksum()).
+struct Checkpoint {
+
+  // Setup
+  std::string family;
+  std::string performanceMeasure;
+  uint32_t intercept;
+  double errorVal;
+  uint64_t dataChecksum;
+  uint32_t nFeatures;
+  uint32_t combsUpTo;
+  uint32_t order;
+  uint64_t nTrain;
+  uint64_t nTest;
+  uint64_t nResults;
+  uint64_t rankStart;
+  uint64_t rankEnd;
+  uint64_t nChunks;
+
+  // State
+  uint64_t runtimeSec;
+  // The costs the chunks were balanced by (Combination::setSizeCosts())
+  std::vector<double> sizeCosts;
+  std::vector<char> chunkDone;
+  std::vector<std::pair<double, uint64_t>> entries;
+
+  Checkpoint() : intercept(0), errorVal(0), dataChecksum(0), nFeatures(0),
+    combsUpTo(0), order(0), nTrain(0), nTest(0), nResults(0), rankStart(0),
+    rankEnd(0), nChunks(0), runtimeSec(0) {}
+
+  // True if other was written by a search with the same setup. The number of
+  // chunks is not compared, as a resumed search takes it from the checkpoint.
+  bool matches(const Checkpoint& other) const;
+
+  // The file is first written to file + ".tmp", which then replaces file. So
+  // an existing checkpoint is never left half written. Both functions throw a
+  // std::runtime_error on failure.
+  void write(const std::string& file) const;
+  void read(const std::string& file);
+};
+
+// Continues the checksum hash with the n values (a 64-bit FNV-1a hash over
+// their bit patterns). Start with hash = 0.
+uint64_t dataChecksum(uint64_t hash, const double* values, size_t n);
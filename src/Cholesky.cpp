@@ -0,0 +1,86 @@
+#include <math.h>
+
+#include "Cholesky.h"
+
+
+bool CholeskyFactor::appendRow(const double* a, double aDiag, double b) {
+
+  // Make room for the new row. The vectors only grow, so after the largest
+  // combination was seen once, no further allocations are made.
+  size_t start = rowStart(m_dim);
+  if (m_L.size() < start + m_dim + 1) m_L.resize(start + m_dim + 1);
+  if (m_z.size() < m_dim + 1) m_z.resize(m_dim + 1);
+  double* l = &m_L[start];
+
+  // Forward substitution L * l = a gives the off-diagonal part of the new row
+  double lNormSq = 0.0;
+  for (size_t j = 0; j < m_dim; j++) {
+    const double* Lj = &m_L[rowStart(j)];
+    double s = a[j];
+    for (size_t m = 0; m < j; m++) s -= Lj[m] * l[m];
+    l[j] = s / Lj[j];
+    lNormSq += l[j] * l[j];
+  }
+
+  // The remaining diagonal element has to be clearly positive
+  double pivot = aDiag - lNormSq;
+  if (!(pivot > m_tol * aDiag)) return false;
+  l[m_dim] = sqrt(pivot);
+
+  // Extend z = L^-1 * b accordingly
+  double s = b;
+  for (size_t j = 0; j < m_dim; j++) s -= l[j] * m_z[j];
+  m_z[m_dim] = s / l[m_dim];
+
+  m_dim++;
+  return true;
+}
+
+
+void CholeskyFactor::removeRow(size_t p) {
+
+  // Without row p, each following row q + 1 has one entry too many for its new
+  // position q. A rotation of the columns q and q + 1 removes it, and needs to
+  // be applied to all later rows and to z as well.
+  for (size_t q = p; q + 1 < m_dim; q++) {
+    double* row = &m_L[rowStart(q + 1)];
+    double a = row[q], b = row[q + 1];
+    double r = sqrt(a * a + b * b);
+    double c = a / r, s = b / r;
+
+    for (size_t i = q + 2; i < m_dim; i++) {
+      double* Li = &m_L[rowStart(i)];
+      double x = Li[q], y = Li[q + 1];
+      Li[q] = c * x + s * y;
+      Li[q + 1] = c * y - s * x;
+    }
+    double x = m_z[q], y = m_z[q + 1];
+    m_z[q] = c * x + s * y;
+    m_z[q + 1] = c * y - s * x;
+
+    // Move the row into its new position. Targets always lie before sources.
+    row[q] = r;
+    double* target = &m_L[rowStart(q)];
+    for (size_t j = 0; j <= q; j++) target[j] = row[j];
+  }
+  m_dim--;
+}
+
+
+double CholeskyFactor::rhsNormSq() const {
+
+  double s = 0.0;
+  for (size_t j = 0; j < m_dim; j++) s += m_z[j] * m_z[j];
+  return s;
+}
+
+
+void CholeskyFactor::solve(double* beta) const {
+
+  // Back substitution L' * beta = z. Column j of L' is row j of L.
+  for (size_t j = m_dim; j-- > 0;) {
+    double s = m_z[j];
+    for (size_t m = j + 1; m < m_dim; m++) s -= m_L[rowStart(m) + j] * beta[m];
+    beta[j] = s / m_L[rowStart(j) + j];
+  }
+}
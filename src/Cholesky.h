@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+
+// A CholeskyFactor holds the lower triangular factor L of a symmetric positive
+// definite matrix A = L * L', which is built up one row (= one variable) at a
+// time. Alongside, it keeps z = L^-1 * b for a right hand side b. For a Gram
+// matrix A = X'X and b = X'y this gives everything needed for least squares:
+// the coefficients solve L' * beta = z, and the residual sum of squares is
+// y'y - z'z. L is stored row by row in packed form.
+class CholeskyFactor {
+
+  size_t m_dim;
+  std::vector<double> m_L;
+  std::vector<double> m_z;
+  // A new pivot is rejected if it is smaller than m_tol times the diagonal
+  // element of A, i.e. if the variable is (almost) collinear to the others.
+  double m_tol;
+
+  static size_t rowStart(size_t i) { return i * (i + 1) / 2; }
+
+public:
+  CholeskyFactor(double tol = 1e-10) : m_dim(0), m_tol(tol) {}
+
+  size_t size() const { return m_dim; }
+
+  // Allocates the storage for up to maxDim variables in advance
+  void reserve(size_t maxDim) {
+    if (m_L.size() < rowStart(maxDim)) m_L.resize(rowStart(maxDim));
+    if (m_z.size() < maxDim) m_z.resize(maxDim);
+  }
+
+  // Drops all rows from index dim onwards
+  void truncate(size_t dim) { if (dim < m_dim) m_dim = dim; }
+
+  // Adds a variable with cross products a[0..size()-1] to the existing ones,
+  // the diagonal element aDiag and the right hand side element b. Returns
+  // false (and leaves the factor unchanged) if A would not be positive
+  // definite.
+  bool appendRow(const double* a, double aDiag, double b);
+
+  // Removes the variable of row p in O(size()^2). The rows below are moved up
+  // and rotated back into triangular form by Givens rotations, which are also
+  // applied to z. This is a rank-one downdate of the factors of these rows.
+  void removeRow(size_t p);
+
+  // z'z, which is b' * A^-1 * b
+  double rhsNormSq() const;
+
+  // Solves A * beta = b, with beta of length size()
+  void solve(double* beta) const;
+};
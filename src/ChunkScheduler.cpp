@@ -0,0 +1,51 @@
+#include "ChunkScheduler.h"
+
+
+ChunkScheduler::ChunkScheduler(size_t nThreads, size_t nChunks,
+  const std::vector<char>& skip) :
+  m_nThreads(nThreads > 0 ? nThreads : 1) {
+
+  m_queues.reserve(m_nThreads);
+  for (size_t t = 0; t < m_nThreads; t++)
+    m_queues.emplace_back(new WorkerQueue());
+
+  // Thread t initially owns the t-th contiguous block of chunks. Neighboring
+  // chunks share long prefixes, so working through a block front to back keeps
+  // the combinations of a thread close to each other.
+  for (size_t c = 0; c < nChunks; c++) {
+    if (c < skip.size() && skip[c]) continue;
+    m_queues[c * m_nThreads / nChunks]->chunks.push_back(c);
+  }
+}
+
+
+bool ChunkScheduler::next(size_t threadID, size_t& chunkID) {
+  return popOwn(threadID, chunkID) || steal(threadID, chunkID);
+}
+
+
+bool ChunkScheduler::popOwn(size_t threadID, size_t& chunkID) {
+
+  WorkerQueue& own = *m_queues[threadID];
+  std::lock_guard<std::mutex> lockGuard(own.mtx);
+  if (own.chunks.empty()) return false;
+  chunkID = own.chunks.front();
+  own.chunks.pop_front();
+  return true;
+}
+
+
+bool ChunkScheduler::steal(size_t threadID, size_t& chunkID) {
+
+  // Visit all other threads once, starting with the right neighbor, and take
+  // the last chunk of the first one that still has work queued.
+  for (size_t i = 1; i < m_nThreads; i++) {
+    WorkerQueue& victim = *m_queues[(threadID + i) % m_nThreads];
+    std::lock_guard<std::mutex> lockGuard(victim.mtx);
+    if (victim.chunks.empty()) continue;
+    chunkID = victim.chunks.back();
+    victim.chunks.pop_back();
+    return true;
+  }
+  return false;
+}
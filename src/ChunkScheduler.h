@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+// A ChunkScheduler distributes the chunks (small batches of combinations) of a
+// search onto the worker threads. Every thread owns a deque of chunk IDs,
+// which is initially filled with a contiguous block of chunks. A thread takes
+// its work from the front of its own deque. If that is empty, it steals a
+// chunk from the back of another thread's deque. This keeps all threads busy
+// until the very last chunk is done, even if some chunks take much longer than
+// others.
+class ChunkScheduler {
+
+  // Each worker has its own lock, so stealing only blocks the victim thread.
+  struct WorkerQueue {
+    std::mutex mtx;
+    std::deque<size_t> chunks;
+  };
+
+  size_t m_nThreads;
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+  bool popOwn(size_t threadID, size_t& chunkID);
+  bool steal(size_t threadID, size_t& chunkID);
+
+public:
+  // Chunks c with skip[c] set (e.g. completed ones of a resumed search) are
+  // not scheduled.
+  ChunkScheduler(size_t nThreads, size_t nChunks,
+    const std::vector<char>& skip = std::vector<char>());
+  size_t getNThreads() const { return m_nThreads; }
+
+  // Sets chunkID to the next chunk to be evaluated by thread threadID. Returns
+  // false if there is no work left anywhere.
+  bool next(size_t threadID, size_t& chunkID);
+};
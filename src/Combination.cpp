@@ -1,5 +1,4 @@
-
-#include <math.h>
+#include <algorithm>
 
 #include "Combination.h"
 
@@ -29,115 +28,275 @@ size_t computeCombinations(uint N, uint k){
 }
 
 
-Combination::Combination(uint N, uint k, size_t nBatches) :
-    m_N(N), m_k(k), m_nBatches(nBatches) {
+Combination::Combination(uint N, uint k, size_t nBatches,
+    EnumerationOrder order, size_t rankStart, size_t rankEnd) :
+    m_N(N), m_k(k), m_order(order), m_rankStart(rankStart),
+    m_rankEnd(rankEnd), m_nBatches(nBatches) {
 
     // Compute the total number of existing combinations with this setup.
     m_nCombinations = computeCombinations(m_N, m_k);
+    if (m_rankEnd > m_nCombinations) m_rankEnd = m_nCombinations;
+    if (m_rankStart > m_rankEnd) m_rankStart = m_rankEnd;
+
+    // There cannot be more (non-empty) batches than combinations
+    size_t nRanks = m_rankEnd - m_rankStart;
+    if (m_nBatches > nRanks) m_nBatches = nRanks;
+
+    // Pascal's triangle up to N over k for rank() and unrank()
+    m_binom.assign((m_N + 1) * (m_k + 1), 0);
+    for (uint n = 0; n <= m_N; n++) {
+        m_binom[n * (m_k + 1)] = 1;
+        for (uint m = 1; m <= m_k && m <= n; m++)
+            m_binom[n * (m_k + 1) + m] = binom(n - 1, m - 1) + binom(n - 1, m);
+    }
 
-    // The following algorithm computes a set of starting combinations that
-    // split all combinations into almost equal sized parts and returns
-    // a vector of the combinations that divide the batches
-
-    // The intended minimal size of each batch. Use ceil(), if it would create
-    // enough batches, if not, use floor() (= ceil() - 1).
-    size_t targetSize = ceil(((float)m_nCombinations) / m_nBatches);
-    if (targetSize * (m_nBatches - 1) >= m_nCombinations) targetSize--;
-
-    // Initial limit needs to be "(0)" as the evaluation calls nextCombination()
-    // as a first step, which thus results in the true first element "(1)"
-    std::vector<uint> element{0};
-    m_batchLimits.emplace_back(element);
-
-    // The current position within 'element' under evaluation
-    int indent = 0;
-    // The current length 'element', basically just: element.size();
-    size_t curLength = element.size();
-    // The current value under inspection, basically just: element[indent];
-    uint digit = 0;
-    // Both values are necessary copies, as element gets changed repeatedly
-
-    // One iteration per batch limit to be identified
-    for (size_t j = 0; j < m_nBatches; j++) {
-
-        // The final iteration is trivial so avoid unnecessary computations here
-        if (j == m_nBatches - 1) {
-            // Insert the last combination
-            element.clear();
-            for (uint i = m_N - m_k + 1; i <= m_N ; i++)
-                element.emplace_back(i);
-            m_batchLimits.push_back(element);
-
-            // Insert the size of the remaining combinations
-            size_t combsNow = 0;
-            for (size_t& n : m_batchSizes) combsNow += n;
-            m_batchSizes.push_back(m_nCombinations - combsNow);
-
-            break;
+    m_sizeOffsets.assign(m_k + 2, 0);
+    for (uint K = 1; K <= m_k; K++)
+        m_sizeOffsets[K + 1] = m_sizeOffsets[K] + binom(m_N, K);
+
+    // Sums of the depth-first subtree sizes. A subtree below an element with
+    // t larger elements left and m more elements allowed holds all their
+    // subsets of up to m elements.
+    m_subtreeSums.assign((m_N + 2) * (m_k + 1), 0);
+    for (uint t = 0; t <= m_N; t++) {
+        size_t subsets = 0;
+        for (uint m = 0; m <= m_k; m++) {
+            subsets += binom(t, m);
+            m_subtreeSums[(t + 1) * (m_k + 1) + m] = subtreeSum(t, m) + subsets;
         }
+    }
+
+    splitBatches();
+}
+
 
-        // Continue to add combs until the batch size is reached
-        size_t curBatchSize = 0;
-        size_t projectedSize = 0;
-        while (curBatchSize < targetSize) {
-
-            // Identify at which position (indent) I can increase without
-            // overshooting the targetSize. There is always the option to just
-            // add 1 combination, so this loop will terminate eventually.
-            do {
-                // What would an increase add to curBatchSize?
-                projectedSize = curBatchSize +
-                    NoverK(m_N - element[indent], curLength - indent - 1);
-
-                // If it would overshoot, I will retry with a higher indent
-                if (projectedSize > targetSize) indent++;
-            } while (projectedSize > targetSize);
-
-            // I have now decided which step to make, so lets make it
-
-            // First find the indent at which it is possible to increase
-            while (element[indent] >= m_N - curLength + indent + 1) {
-                indent--;
-                if (indent == -1) break;
+void Combination::setSizeCosts(const std::vector<double>& sizeCosts) {
+    m_sizeCosts = sizeCosts;
+    splitBatches();
+}
+
+
+double Combination::cumulativeCost(size_t r) const {
+
+    // Without a cost model, the cost is the number of combinations
+    if (m_sizeCosts.empty()) return (double)r;
+
+    // The combinations are ordered by size: Complete sizes before r and the
+    // part of the size of r. This also covers the total cost of all ranks.
+    double cost = 0.0;
+    if (m_order != DEPTH_FIRST || r >= m_nCombinations) {
+        for (uint K = 1; K <= m_k && m_sizeOffsets[K] < r; K++) {
+            size_t n = std::min(r, m_sizeOffsets[K + 1]) - m_sizeOffsets[K];
+            cost += n * m_sizeCosts[K];
+        }
+        return cost;
+    }
+
+    // Like in rankDFS(), r is preceded by the prefixes of its combination and
+    // complete sibling subtrees. These subtrees hold binom(t, j) combinations
+    // with j more elements for t elements left, which are summed over all t
+    // at once.
+    std::vector<uint> comb = unrank(r);
+    uint prev = 0;
+    for (uint i = 0; i < comb.size(); i++) {
+        if (i > 0) cost += m_sizeCosts[i];
+        for (uint j = 0; j <= m_k - i - 1; j++) {
+            double n = (double)binom(m_N - prev, j + 1) -
+                (double)binom(m_N - comb[i] + 1, j + 1);
+            cost += n * m_sizeCosts[i + 1 + j];
+        }
+        prev = comb[i];
+    }
+    return cost;
+}
+
+
+void Combination::splitBatches() {
+
+    m_batchStarts.clear();
+    m_batchSizes.clear();
+
+    // An empty rank range has no batches
+    if (m_nBatches == 0) return;
+
+    size_t nRanks = m_rankEnd - m_rankStart;
+    if (m_sizeCosts.empty()) {
+        // Split the rank range into almost equal sized parts. Batch j covers
+        // the ranks [j * nRanks / nBatches, (j + 1) * nRanks / nBatches)
+        // (relative to m_rankStart). The products are split up to avoid
+        // overflows for huge search spaces.
+        size_t quot = nRanks / m_nBatches;
+        size_t rem = nRanks % m_nBatches;
+        for (size_t j = 0; j <= m_nBatches; j++)
+            m_batchStarts.push_back(m_rankStart + j * quot +
+                j * rem / m_nBatches);
+    } else {
+        // Batch j starts at the last rank, before which at most j / nBatches
+        // of the total cost of the range lie (like above for equal costs).
+        // Each batch keeps at least one combination.
+        double costStart = cumulativeCost(m_rankStart);
+        double costRange = cumulativeCost(m_rankEnd) - costStart;
+        m_batchStarts.push_back(m_rankStart);
+        for (size_t j = 1; j < m_nBatches; j++) {
+            double target = costStart + costRange * j / m_nBatches;
+            size_t lo = m_batchStarts[j - 1] + 1;
+            size_t hi = m_rankEnd - (m_nBatches - j);
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo + 1) / 2;
+                if (cumulativeCost(mid) <= target) lo = mid;
+                else hi = mid - 1;
             }
+            m_batchStarts.push_back(lo);
+        }
+        m_batchStarts.push_back(m_rankEnd);
+    }
+
+    for (size_t j = 1; j <= m_nBatches; j++)
+        m_batchSizes.push_back(m_batchStarts[j] - m_batchStarts[j - 1]);
+}
+
+
+size_t Combination::rank(const std::vector<uint>& comb) const {
+    switch (m_order) {
+    case DEPTH_FIRST: return rankDFS(comb);
+    case REVOLVING_DOOR: return rankRevolvingDoor(comb);
+    default: return rankSizeFirst(comb);
+    }
+}
+
+
+void Combination::unrank(size_t r, std::vector<uint>& comb) const {
+    switch (m_order) {
+    case DEPTH_FIRST: unrankDFS(r, comb); break;
+    case REVOLVING_DOOR: unrankRevolvingDoor(r, comb); break;
+    default: unrankSizeFirst(r, comb);
+    }
+}
+
+
+void Combination::next(std::vector<uint>& comb) const {
+    switch (m_order) {
+    case DEPTH_FIRST: setNextCombinationDFS(comb, m_N, m_k); break;
+    case REVOLVING_DOOR: setNextCombinationRevolvingDoor(comb, m_N); break;
+    default: setNextCombination(comb, m_N);
+    }
+}
+
+
+size_t Combination::rankSizeFirst(const std::vector<uint>& comb) const {
+
+    uint K = comb.size();
+
+    // Within the combinations of size K, the lexicographic rank is the number
+    // of combinations following comb subtracted from the last rank. These are
+    // counted by the combinatorial number system of (N - comb[0], ...).
+    size_t following = 0;
+    for (uint i = 0; i < K; i++) following += binom(m_N - comb[i], K - i);
+
+    return m_sizeOffsets[K] + binom(m_N, K) - 1 - following;
+}
+
 
-            // Is there still a way to increase the current combination?
-            if (indent != -1) {
-                // Increase at indent position and set all following accordingly
-                digit = element[indent];
-                for (size_t i = 0; i < (curLength - indent); i++)
-                    element[indent + i] =  digit + i + 1;
-
-            // indent == -1 means no increase possible at current length
-            // Try to start with the next larger length if possible.
-            } else if (curLength < m_k) {
-                curLength++;
-                indent = 0;
-                element.clear();
-                for (uint i = 1; i <= curLength ; i++) element.emplace_back(i);
-
-            // If not possible, the last combination was reached and its done.
-            // Note: this should never be reached, due to the shortcut taken in
-            // the final iteration
-            } else break;
-
-            // The step was made and the projected size is now reality.
-            curBatchSize = projectedSize;
+void Combination::unrankSizeFirst(size_t r, std::vector<uint>& comb) const {
+
+    // Find the size of the combination with rank r
+    uint K = 1;
+    while (r >= m_sizeOffsets[K + 1]) K++;
+
+    // The number of combinations of size K that follow the one of rank r
+    size_t following = binom(m_N, K) - 1 - (r - m_sizeOffsets[K]);
+
+    comb.resize(K);
+    uint dMax = m_N;
+    for (uint i = 0; i < K; i++) {
+        // Find the largest d < dMax with (d over K - i) <= following. The
+        // binomial coefficient is increasing in d, so a binary search is used.
+        uint lo = K - i - 1, hi = dMax - 1;
+        while (lo < hi) {
+            uint mid = lo + (hi - lo + 1) / 2;
+            if (binom(mid, K - i) <= following) lo = mid;
+            else hi = mid - 1;
         }
+        following -= binom(lo, K - i);
+        comb[i] = m_N - lo;
+        dMax = lo;
+    }
+}
+
 
-        // A combination was found -> Add it.
-        m_batchLimits.emplace_back(element);
+size_t Combination::rankDFS(const std::vector<uint>& comb) const {
+
+    // Every combination is preceded by its own prefixes and by the complete
+    // subtrees of all smaller siblings of its elements and their prefixes.
+    size_t r = comb.size() - 1;
+    uint prev = 0;
+    for (uint i = 0; i < comb.size(); i++) {
+        // Subtrees of the values prev + 1, ..., comb[i] - 1 at position i
+        r += subtreeSum(m_N - prev, m_k - i - 1) -
+            subtreeSum(m_N - comb[i] + 1, m_k - i - 1);
+        prev = comb[i];
+    }
+    return r;
+}
 
-        // Also add the resulting batch size to m_batchSizes
-        m_batchSizes.emplace_back(curBatchSize);
 
-        // This line just ensures that the algorithm finishes after the last
-        // combination, even if for some reason the combinations were split into
-        // less than m_nBatches.
-        if (curLength == m_k && element[0] == m_N - m_k + 1) {
-            m_nBatches = m_batchSizes.size();
-            break;
+void Combination::unrankDFS(size_t r, std::vector<uint>& comb) const {
+
+    comb.clear();
+    uint prev = 0;
+    for (uint i = 0; i < m_k; i++) {
+        uint m = m_k - i - 1;
+        // Skip as many complete sibling subtrees as possible: Find the largest
+        // value v for which the subtrees of prev + 1, ..., v - 1 fit into r.
+        uint lo = prev + 1, hi = m_N;
+        while (lo < hi) {
+            uint mid = lo + (hi - lo + 1) / 2;
+            if (subtreeSum(m_N - prev, m) - subtreeSum(m_N - mid + 1, m) <= r)
+                lo = mid;
+            else hi = mid - 1;
         }
+        r -= subtreeSum(m_N - prev, m) - subtreeSum(m_N - lo + 1, m);
+        comb.push_back(lo);
+
+        // Either the combination itself is reached, or go down its subtree
+        if (r == 0) return;
+        r--;
+        prev = lo;
+    }
+}
+
+
+// Ranking and unranking of the revolving door order within each size follow
+// algorithms 2.11 and 2.12 of Kreher & Stinson (1999): Combinatorial
+// Algorithms: Generation, Enumeration, and Search.
+size_t Combination::rankRevolvingDoor(const std::vector<uint>& comb) const {
+
+    uint K = comb.size();
+
+    // The alternating sum starts with -1 for odd K and stays non-negative
+    size_t r = m_sizeOffsets[K];
+    bool odd = K % 2 == 1;
+    for (uint i = K; i >= 1; i--) {
+        if ((K - i) % 2 == 0) r += binom(comb[i - 1], i);
+        else r -= binom(comb[i - 1], i);
+    }
+    return odd ? r - 1 : r;
+}
+
+
+void Combination::unrankRevolvingDoor(size_t r, std::vector<uint>& comb) const {
+
+    // Find the size of the combination with rank r
+    uint K = 1;
+    while (r >= m_sizeOffsets[K + 1]) K++;
+    r -= m_sizeOffsets[K];
+
+    comb.resize(K);
+    uint x = m_N;
+    for (uint i = K; i >= 1; i--) {
+        while (binom(x, i) > r) x--;
+        comb[i - 1] = x + 1;
+        r = binom(x + 1, i) - r - 1;
     }
 }
 
@@ -166,3 +325,65 @@ void setNextCombination(std::vector<uint>& comb, const size_t& N) {
             comb[i] = comb[indent] + i - indent;
     }
 }
+
+
+// A free function that computes the next combination in depth-first order
+void setNextCombinationDFS(std::vector<uint>& comb, const size_t& N,
+    const size_t& k) {
+
+    // Go deeper, if the combination can still be extended
+    if (comb.size() < k && comb.back() < N) {
+        comb.push_back(comb.back() + 1);
+        return;
+    }
+
+    // Otherwise go to the next sibling
+    setNextSiblingDFS(comb, N);
+}
+
+
+void setNextSiblingDFS(std::vector<uint>& comb, const size_t& N) {
+
+    // Take the next sibling of a parent if the last element cannot be
+    // increased any more
+    while (!comb.empty() && comb.back() == N) comb.pop_back();
+    if (!comb.empty()) comb.back()++;
+}
+
+
+// A free function that computes the next combination in revolving door order
+// (algorithm 2.13 of Kreher & Stinson, 1999). After the last combination of a
+// size, which is (1, 2, ..., k - 1, N), the first one of size k + 1 follows.
+void setNextCombinationRevolvingDoor(std::vector<uint>& comb, const size_t& N) {
+
+    uint k = comb.size();
+
+    // j is the first (1-based) position that does not hold its minimal value
+    uint j = 1;
+    while (j <= k && comb[j - 1] == j) j++;
+
+    // The last combination of this size: Start with the next larger size
+    if (j == k && comb[k - 1] == N) {
+        comb.resize(k + 1);
+        for (uint i = 1; i <= k + 1; i++) comb[i - 1] = i;
+        return;
+    }
+
+    // (j + 1)-th element, which is N + 1 beyond the end of the combination
+    uint next = j < k ? comb[j] : N + 1;
+
+    if ((k - j) % 2 == 1) {
+        if (j == 1) {
+            comb[0]--;
+        } else {
+            comb[j - 2] = j;
+            if (j > 2) comb[j - 3] = j - 1;
+        }
+    } else if (next != comb[j - 1] + 1) {
+        if (j > 1) comb[j - 2] = comb[j - 1];
+        comb[j - 1]++;
+    } else {
+        comb[j] = comb[j - 1];
+        comb[j - 1] = j;
+    }
+}
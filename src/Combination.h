@@ -1,34 +1,131 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 #include <vector>
 
 
 typedef unsigned int  uint;
 
+// The order in which the combinations of 1 to k elements are enumerated:
+// - SIZE_FIRST: by size first, and lexicographically within each size, i.e.
+//   (1), (2), ..., (N), (1, 2), ... (see setNextCombination())
+// - DEPTH_FIRST: a depth-first walk through the tree of combinations, in which
+//   each combination is directly followed by its extensions, i.e.
+//   (1), (1, 2), (1, 2, 3), ..., (1, 3), ... (see setNextCombinationDFS())
+//   Consecutive combinations mostly share all but their last element.
+// - REVOLVING_DOOR: by size first, and within each size in revolving door order
+//   (a Gray code), in which each combination differs from the previous one by
+//   exactly one element swapped in and one swapped out
+//   (see setNextCombinationRevolvingDoor()).
+enum EnumerationOrder { SIZE_FIRST, DEPTH_FIRST, REVOLVING_DOOR };
+
 // A Combination object holds a setup of combinations for given N and k. It also
 // includes a static function to compute the next combination from a given one.
+//
+// The position of a combination within the enumeration order is its rank
+// (starting at 0). rank() and unrank() convert between both representations in
+// O(k log N) by the combinatorial number system, so any rank range can be
+// evaluated directly.
 class Combination {
 
   // The number of elements to choose from
 	uint m_N;
   // The upper limit of elements per combination
 	uint m_k;
+	EnumerationOrder m_order;
 	size_t m_nCombinations;
-  // The total set of combination is split into equal sized batches for threads
+  // The rank range [m_rankStart, m_rankEnd) to be evaluated (all by default)
+  size_t m_rankStart;
+  size_t m_rankEnd;
+  // The rank range is split into batches, which are handed out to the threads
+  // as chunks of work.
   size_t m_nBatches;
-  std::vector<std::vector<uint>> m_batchLimits;
   std::vector<size_t> m_batchSizes;
+  // The rank of the first combination of each batch (and m_rankEnd)
+  std::vector<size_t> m_batchStarts;
+  // Estimated cost of evaluating a combination of each size K (at index K),
+  // by which the batches are balanced. Empty if all cost the same.
+  std::vector<double> m_sizeCosts;
+
+  // Lookup table of binomial coefficients:
+  // m_binom[n * (m_k + 1) + m] = n over m
+  std::vector<size_t> m_binom;
+  // m_sizeOffsets[K] is the rank of the first combination with K elements
+  std::vector<size_t> m_sizeOffsets;
+  // Cumulative subtree sizes of the depth-first order: m_subtreeSums[t *
+  // (m_k + 1) + m] is the sum over t' < t of the number of subsets of t'
+  // elements with at most m elements (including the empty set).
+  std::vector<size_t> m_subtreeSums;
+
+  size_t binom(uint n, uint m) const {
+    return m > m_k ? 0 : m_binom[n * (m_k + 1) + m];
+  }
+  size_t subtreeSum(uint t, uint m) const {
+    return m_subtreeSums[t * (m_k + 1) + m];
+  }
+
+  // The total cost of all combinations with a rank below r
+  double cumulativeCost(size_t r) const;
+  // Splits the rank range into m_nBatches batches of about the same cost
+  void splitBatches();
+
+  size_t rankSizeFirst(const std::vector<uint>& comb) const;
+  void unrankSizeFirst(size_t r, std::vector<uint>& comb) const;
+  size_t rankDFS(const std::vector<uint>& comb) const;
+  void unrankDFS(size_t r, std::vector<uint>& comb) const;
+  size_t rankRevolvingDoor(const std::vector<uint>& comb) const;
+  void unrankRevolvingDoor(size_t r, std::vector<uint>& comb) const;
 
 public:
-	Combination(uint N, uint k, size_t nBatches);
+	// Only the ranks [rankStart, rankEnd) are split into batches, so that a
+	// search can be sharded. rankEnd is capped at getNCombinations().
+	Combination(uint N, uint k, size_t nBatches,
+	  EnumerationOrder order = SIZE_FIRST, size_t rankStart = 0,
+	  size_t rankEnd = SIZE_MAX);
 	uint getN() const { return m_N; }
 	uint getK() const { return m_k; }
+	EnumerationOrder getOrder() const { return m_order; }
 	size_t getNCombinations() const { return m_nCombinations; }
+	size_t getRankStart() const { return m_rankStart; }
+	size_t getRankEnd() const { return m_rankEnd; }
 	size_t getNBatches() const { return m_nBatches; }
-	std::vector<std::vector<uint>> getBatchLimits() const { return m_batchLimits; }
-	std::vector<size_t> getBatchSizes() const { return m_batchSizes; }
+	const std::vector<size_t>& getBatchSizes() const { return m_batchSizes; }
+	const std::vector<size_t>& getBatchStarts() const { return m_batchStarts; }
+	// Balances the batches by the cost of a combination of each size K given
+	// at sizeCosts[K] (K = 1, ..., k), instead of by their number
+	void setSizeCosts(const std::vector<double>& sizeCosts);
+	const std::vector<double>& getSizeCosts() const { return m_sizeCosts; }
+
+	// The rank of a combination (sorted, elements in 1..N, size 1..k)
+	size_t rank(const std::vector<uint>& comb) const;
+	// Writes the combination with rank r (< getNCombinations()) into comb
+	void unrank(size_t r, std::vector<uint>& comb) const;
+	std::vector<uint> unrank(size_t r) const {
+	  std::vector<uint> comb;
+	  unrank(r, comb);
+	  return comb;
+	}
+	// Steps to the next combination in the enumeration order
+	void next(std::vector<uint>& comb) const;
+	// The number of extensions of comb by larger elements (up to k elements in
+	// total), i.e. the size of its subtree in depth-first order without itself
+	size_t nExtensions(const std::vector<uint>& comb) const {
+	  uint t = m_N - comb.back(), m = m_k - comb.size();
+	  return subtreeSum(t + 1, m) - subtreeSum(t, m) - 1;
+	}
 };
 
 // A free function that can compute the next combination from a given one
 void setNextCombination(std::vector<uint>& comb, const size_t& N);
+
+// The same for the depth-first order. An empty comb marks the end.
+void setNextCombinationDFS(std::vector<uint>& comb, const size_t& N,
+  const size_t& k);
+
+// Steps over all extensions of comb in depth-first order, i.e. to its next
+// sibling or the next sibling of a parent. An empty comb marks the end.
+void setNextSiblingDFS(std::vector<uint>& comb, const size_t& N);
+
+// The same for the revolving door order
+void setNextCombinationRevolvingDoor(std::vector<uint>& comb, const size_t& N);
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <RcppArmadillo.h>
+#include "Platform.h"
+
+#include "GramMatrix.h"
 
 
 // A simple struct to hold pointers to a training/testing data set combination
@@ -10,10 +12,15 @@ struct DataSet {
     const std::vector<double> * yTrain;
     const arma::mat * XTest;
     const std::vector<double> * yTest;
+    // Optional precomputed statistics of the training and test data (gaussian
+    // family)
+    const GramMatrix * GramTrain;
+    const GramMatrix * GramTest;
 
     DataSet(const arma::mat*& XTrain, const std::vector<double>*& yTrain,
         const arma::mat*& XTest, const std::vector<double>*& yTest)
-    : XTrain(XTrain), yTrain(yTrain), XTest(XTest), yTest(yTest) {}
+    : XTrain(XTrain), yTrain(yTrain), XTest(XTest), yTest(yTest),
+      GramTrain(NULL), GramTest(NULL) {}
 
     bool noTestSet() { return XTrain == XTest && yTrain == yTest; }
 };
@@ -1,5 +1,20 @@
+#include <stdexcept>
+#include <thread>
 
-#include "SearchTask.h"
+#include "Search.h"
+#include "ResultFile.h"
+
+
+// The R interface to the search engine (Search.h), which itself does not
+// depend on R
+
+
+// The enumeration order by its name in R
+EnumerationOrder parseEnumeration(const std::string& enumeration) {
+  if (enumeration == "depthFirst") return DEPTH_FIRST;
+  if (enumeration == "revolvingDoor") return REVOLVING_DOOR;
+  return SIZE_FIRST;
+}
 
 
 // [[Rcpp::export]]
@@ -14,51 +29,150 @@ Rcpp::List ExhaustiveSearchCpp(
     size_t combsUpTo,
     size_t nResults,
     size_t nThreads,
+    std::string enumeration,
+    size_t rankStart,
+    size_t rankEnd,
+    std::string checkpointFile,
+    size_t checkpointInterval,
+    bool resume,
+    bool pruning,
+    std::string resultFile,
+    std::string batchCosts,
+    std::string backend,
+    bool pinThreads,
     double errorVal,
     bool quietly) {
 
-  // The data shall not be copied from now on, so only work with pointers stored
-  // in a DataSet object (DataSet.h) for structure.
-  const arma::mat * X = &XInput;
-  const std::vector<double> * y = &yInput;
-  const arma::mat * XT = &XTestSet;
-  const std::vector<double> * yT = &yTestSet;
-
-  // If a TestSet was specified use it, otherwise repeat the training pointers
-  DataSet D(X, y, XTestSet.n_rows > 0 ? XT : X, XTestSet.n_rows > 0 ? yT : y);
-
-  // Initialize the modelling task object
-  GLM Model(D, family, performanceMeasure, intercept, errorVal);
-  GLM* ModelPtr = &Model;
-
-  // Initialize the Combination Object (ncols - 1 because of the Intercept col).
-  // If nThreads was not specified, set it to the number of available threads.
-  Combination Comb(XInput.n_cols - 1, combsUpTo,
-    nThreads > 0 ? nThreads: std::thread::hardware_concurrency());
-  Combination* CombPtr = &Comb;
-
-  // The SearchTask handles the (multithreaded) execution and saves the results
-  SearchTask ST(ModelPtr, CombPtr, nResults, quietly);
-  ST.run();
-
-  // Write the final ranking in reverse order into a formatted result (List)
-  Rcpp::NumericVector AicList;
-  Rcpp::List CombList;
-  while (!ST.rankingEmpty()) {
-    AicList.push_front(ST.rankingTop().first);
-    CombList.push_front(ST.rankingTop().second);
-    ST.popRanking();
-  }
+  SearchSetup setup;
+  setup.family = family;
+  setup.performanceMeasure = performanceMeasure;
+  setup.intercept = intercept;
+  setup.combsUpTo = combsUpTo;
+  setup.nResults = nResults;
+  setup.nThreads = nThreads;
+  setup.order = parseEnumeration(enumeration);
+  setup.rankStart = rankStart;
+  setup.rankEnd = rankEnd;
+  setup.checkpointFile = checkpointFile;
+  setup.checkpointInterval = checkpointInterval;
+  setup.resume = resume;
+  setup.pruning = pruning;
+  setup.resultFile = resultFile;
+  setup.batchCosts = batchCosts;
+  setup.backend = backend == "openmp" ? OPENMP : THREADS;
+  setup.pinThreads = pinThreads;
+  setup.errorVal = errorVal;
+  setup.quietly = quietly;
+
+  SearchResult searchResult = runExhaustiveSearch(XInput, yInput, XTestSet,
+    yTestSet, setup);
 
   // Fill up the result object
   Rcpp::List result;
-  result.push_back(ST.getTotalRuntimeSec());
-  result.push_back(AicList);
+  result.push_back(searchResult.runtimeSec);
+  result.push_back(searchResult.performance);
+  result.push_back(searchResult.combinations);
+  result.push_back(searchResult.nModels);
+  result.push_back(searchResult.nBatches);
+  result.push_back(searchResult.batchSizes);
+  result.push_back(searchResult.nThreads);
+  result.push_back(searchResult.nPruned);
+  result.push_back(searchResult.resultFiles);
+
+  return result;
+}
+
+
+// [[Rcpp::export]]
+Rcpp::List ReadResultFilesCpp(
+    const std::vector<std::string>& files,
+    double n,
+    double maxPerformance) {
+
+  std::vector<ResultRecord> records;
+  uint32_t nFeatures = 0, combsUpTo = 0, order = 0;
+  readResultFiles(files, n < (double)SIZE_MAX ? (size_t)n : SIZE_MAX,
+    maxPerformance, records, nFeatures, combsUpTo, order);
+
+  // Only the selected models are decoded into feature combinations
+  Combination Comb(nFeatures, combsUpTo, 0, (EnumerationOrder)order);
+  Rcpp::NumericVector RankList(records.size());
+  Rcpp::NumericVector PerformanceList(records.size());
+  Rcpp::List CombList(records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].rank >= Comb.getNCombinations())
+      throw std::runtime_error("The result files are corrupt.");
+    RankList[i] = (double)records[i].rank;
+    PerformanceList[i] = records[i].performance;
+    CombList[i] = Comb.unrank(records[i].rank);
+  }
+
+  Rcpp::List result;
+  result.push_back(RankList);
+  result.push_back(PerformanceList);
   result.push_back(CombList);
-  result.push_back(ST.getProgress());
-  result.push_back(Comb.getNBatches());
-  result.push_back(Comb.getBatchSizes());
-  result.push_back(Comb.getBatchLimits());
+  return result;
+}
+
+
+// [[Rcpp::export]]
+Rcpp::List EstimateRuntimeCpp(
+    const arma::mat& XInput, // Design Matrix (with intercept column!)
+    const std::vector<double>& yInput,
+    const arma::mat& XTestSet,
+    const std::vector<double>& yTestSet,
+    std::string family,
+    std::string performanceMeasure,
+    bool intercept,
+    size_t combsUpTo,
+    std::string enumeration,
+    size_t nSamples,
+    double seed) {
+
+  SearchSetup setup;
+  setup.family = family;
+  setup.performanceMeasure = performanceMeasure;
+  setup.intercept = intercept;
+  setup.combsUpTo = combsUpTo;
+  setup.order = parseEnumeration(enumeration);
+
+  RuntimeEstimate estimate = estimateRuntime(XInput, yInput, XTestSet,
+    yTestSet, setup, nSamples, (uint64_t)seed);
 
+  Rcpp::List result;
+  result.push_back(estimate.secPerModel);
+  result.push_back(estimate.variance);
+  result.push_back(estimate.setupSec);
+  result.push_back(std::thread::hardware_concurrency());
+  return result;
+}
+
+
+// Enumerates all combinations of up to k of N features in the given order, for
+// the tests of the Combination class: unrank() of every rank, rank() of these
+// combinations, and the combinations walked by next() from the first one
+// [[Rcpp::export]]
+Rcpp::List EnumerateCombinationsCpp(
+    size_t N,
+    size_t k,
+    std::string enumeration) {
+
+  Combination Comb(N, k, 0, parseEnumeration(enumeration));
+  size_t nCombs = Comb.getNCombinations();
+
+  std::vector<std::vector<uint>> unranked(nCombs), walked(nCombs);
+  std::vector<double> ranks(nCombs);
+  std::vector<uint> comb = Comb.unrank(0);
+  for (size_t r = 0; r < nCombs; r++) {
+    Comb.unrank(r, unranked[r]);
+    ranks[r] = (double)Comb.rank(unranked[r]);
+    walked[r] = comb;
+    if (r + 1 < nCombs) Comb.next(comb);
+  }
+
+  Rcpp::List result;
+  result.push_back(unranked);
+  result.push_back(ranks);
+  result.push_back(walked);
   return result;
 }
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cmath>
+#include <math.h>
+#include <stddef.h>
+
+
+// The model families and performance measures are policies, which are fixed
+// at compile time. The evaluation loop is instantiated once per combination
+// (see Search.cpp), so no runtime dispatch is left in it.
+
+// A family defines the distribution of the response and its link function.
+// Besides the linkInverse() for predictions, IRLS (see GLM::computeIRLS())
+// needs the derivative muEta() of the mean by the linear predictor eta (given
+// the mean mu = linkInverse(eta)), the variance() of an observation with mean
+// mu, and startMean() as the starting point of a fit like mustart in glm().
+// Its objective is the sum of loss(), which is the part of the negative
+// log-likelihood of an observation that depends on eta (i.e. half its unit
+// deviance up to a constant). negLogLik() converts the total loss into the
+// negative log-likelihood, with the sum of responseTerm() over all
+// observations and the dispersion (if any) estimated like in the AIC of glm().
+// validResponse() tells whether the family is defined for a response value.
+// All links are canonical (up to the sign for Gamma), so IRLS is Newton's
+// method.
+
+// Linear regression (identity link). The error variance counts as an extra
+// parameter in the AIC.
+struct Gaussian {
+  static const size_t nExtraParams = 1;
+  static double link(double mu) { return mu; }
+  static double linkInverse(double eta) { return eta; }
+  static double muEta(double eta, double mu) { return 1.0; }
+  static double variance(double mu) { return 1.0; }
+  static bool validResponse(double y) { return std::isfinite(y); }
+  static double startMean(double y) { return y; }
+  static double loss(double y, double eta) { return (y - eta) * (y - eta) / 2; }
+  static double responseTerm(double y) { return 0.0; }
+  static double negLogLik(double loss, double n, double responseSum) {
+    return n/2 * (log(2 * M_PI * 2 * loss / n) + 1);
+  }
+};
+
+// Logistic regression (logit link)
+struct Binomial {
+  static const size_t nExtraParams = 0;
+  static double link(double mu) { return log(mu / (1.0 - mu)); }
+  static double linkInverse(double eta) { return 1.0 / (1.0 + exp(-eta)); }
+  static double muEta(double eta, double mu) { return mu * (1.0 - mu); }
+  static double variance(double mu) { return mu * (1.0 - mu); }
+  static bool validResponse(double y) { return y >= 0 && y <= 1; }
+  static double startMean(double y) { return (y + 0.5) / 2; }
+  // log(1 + exp(eta)) - y * eta, which is numerically stable for large |eta|
+  static double loss(double y, double eta) {
+    return (eta > 0 ? eta + log1p(exp(-eta)) : log1p(exp(eta))) - y * eta;
+  }
+  static double responseTerm(double y) { return 0.0; }
+  static double negLogLik(double loss, double n, double responseSum) {
+    return loss;
+  }
+};
+
+// Poisson regression of counts (log link)
+struct Poisson {
+  static const size_t nExtraParams = 0;
+  static double link(double mu) { return log(mu); }
+  static double linkInverse(double eta) { return exp(eta); }
+  static double muEta(double eta, double mu) { return mu; }
+  static double variance(double mu) { return mu; }
+  static bool validResponse(double y) { return y >= 0 && std::isfinite(y); }
+  static double startMean(double y) { return y + 0.1; }
+  static double loss(double y, double eta) { return exp(eta) - y * eta; }
+  // The normalization log(y!) of the Poisson density
+  static double responseTerm(double y) { return lgamma(y + 1.0); }
+  static double negLogLik(double loss, double n, double responseSum) {
+    return loss + responseSum;
+  }
+};
+
+// Gamma regression of positive responses (inverse link, the default of Gamma()
+// in R). Invalid linear predictors eta <= 0 give an infinite loss, from which
+// IRLS halves its step. Like in glm(), the likelihood uses the dispersion
+// deviance / n, which counts as an extra parameter in the AIC.
+struct Gamma {
+  static const size_t nExtraParams = 1;
+  static double link(double mu) { return 1.0 / mu; }
+  static double linkInverse(double eta) { return 1.0 / eta; }
+  static double muEta(double eta, double mu) { return -mu * mu; }
+  static double variance(double mu) { return mu * mu; }
+  static bool validResponse(double y) { return y > 0 && std::isfinite(y); }
+  static double startMean(double y) { return y; }
+  static double loss(double y, double eta) {
+    return eta > 0 ? y * eta - log(eta) : INFINITY;
+  }
+  static double responseTerm(double y) { return log(y); }
+  // The deviance is 2 * (loss - sum(log(y)) - n). With the shape
+  // a = 1 / dispersion, the negLogLik of all observations simplifies to
+  // sum(log(y)) + n/2 + n * a * (1 + log(dispersion)) + n * lgamma(a).
+  static double negLogLik(double loss, double n, double responseSum) {
+    double dispersion = 2 * (loss - responseSum - n) / n;
+    double a = 1.0 / dispersion;
+    return responseSum + n/2 + n * a * (1 + log(dispersion)) + n * lgamma(a);
+  }
+};
+
+
+// Akaike information criterion on the training set
+struct AIC {
+  template <class Model>
+  static double evaluate(Model& M) { return M.getAIC(); }
+};
+
+// Mean squared error on the test set (or the training set, if there is none)
+struct MSE {
+  template <class Model>
+  static double evaluate(Model& M) { return M.getMSE(); }
+};
@@ -2,11 +2,55 @@
 #include "GLM.h"
 
 
-void GLM::setFeatureCombination(const std::vector<uint>& new_comb) {
+template <class Family>
+void GLM<Family>::allocateWorkspace(size_t maxFeatures) {
+
+  size_t maxBeta = maxFeatures + (m_intercept ? 1 : 0);
+  m_beta.resize(maxBeta);
+  m_featureComb.reserve(maxBeta);
+
+  // OLS
+  m_chol.reserve(maxBeta);
+  m_cholComb.reserve(maxBeta);
+  m_gramRow.resize(maxBeta);
+
+  // IRLS (whose buffers are also used by the OLS without Gram matrix)
+  m_hessChol.reserve(maxBeta);
+  m_hessian.resize(maxBeta * maxBeta);
+  m_gradient.resize(maxBeta);
+  m_step.resize(maxBeta);
+
+  // L-BFGS
+  lbfgs_parameter_t param;
+  lbfgs_parameter_init(&param);
+  m_lbfgsWork.resize(lbfgsWorkSize(maxBeta, param));
+
+  // The panel is only needed if the data columns are read
+  if (!std::is_same<Family, Gaussian>::value || m_D.GramTrain == NULL) {
+    m_panel.resize(m_D.XTrain->n_rows * maxBeta);
+    m_panelComb.reserve(maxBeta);
+  }
+  m_block.resize((maxBeta + 2) * M_BLOCK_ROWS);
+
+  const std::vector<double>& y = *m_D.yTrain;
+  m_responseSum = 0.0;
+  for (double y_i : y) m_responseSum += Family::responseTerm(y_i);
+
+  m_warmCombs.resize(maxBeta + 1);
+  m_warmBetas.resize(maxBeta + 1);
+  for (size_t i = 0; i <= maxBeta; i++) {
+    m_warmCombs[i].reserve(i);
+    m_warmBetas[i].reserve(i);
+  }
+}
+
+
+template <class Family>
+void GLM<Family>::setFeatureCombination(const std::vector<uint>& new_comb) {
 
-  // Extract the size of the feature combination and allocate the betas
+  // Extract the size of the feature combination and reset the betas
   m_nBeta = new_comb.size() + (m_intercept ? 1 : 0);
-  m_beta = (double*)malloc(sizeof(double) * m_nBeta);
+  if (m_beta.size() < m_nBeta) m_beta.resize(m_nBeta);
   for (size_t i = 0; i < m_nBeta; i++) m_beta[i] = 0.0;
 
   // Set the new feature combination
@@ -20,30 +64,139 @@ void GLM::setFeatureCombination(const std::vector<uint>& new_comb) {
 }
 
 
-void GLM::fit() {
+template <class Family>
+void GLM<Family>::fit() {
+
+  preparePanel();
+  if (computeIRLS(warmStart()) == 0) storeWarmStart();
+  else m_negloglik = m_errorVal;
+}
+
+
+template <>
+void GLM<Gaussian>::fit() {
+
+  // Use simple matrix algebra for optimization
+  if (computeOLS() < 0) m_negloglik = m_errorVal;
+}
+
+
+template <>
+void GLM<Binomial>::fit() {
+
+  // The selected columns are read many times, so they are copied once
+  preparePanel();
 
-  int ret = 0;
-  if (m_family == "gaussian") {
-    // Use simple matrix algebra for optimization
-    ret = computeOLS();
-  } else if (m_family == "binomial") {
-    // Execute the LBFGS optimizer and compute the betas
-    lbfgs_parameter_t param;
-    lbfgs_parameter_init(&param);
-    ret = lbfgs(m_nBeta, m_beta, &m_negloglik, _evalLogReg, NULL, this,
-      &param);
+  // Start from the coefficients of a related model if possible
+  bool warm = warmStart();
 
-    // Lbfgs has many error codes (negative ret), which are not all real errors.
-    // Unfortunately, I do not know which are still OK, so I assume, that if the
-    // likelihood was set, it is somewhat acceptable (-> room for improvement).
-    if (ret < 0 && m_negloglik !=0) ret = 123;
+  // Small models converge in a few Newton steps
+  if (m_nBeta <= M_IRLS_MAX_BETA) {
+    if (computeIRLS(warm) == 0) {
+      storeWarmStart();
+      return;
+    }
+    // Restart the LBFGS optimizer from zero, if IRLS did not converge
+    for (size_t i = 0; i < m_nBeta; i++) m_beta[i] = 0.0;
   }
+
+  // Otherwise execute the LBFGS optimizer and compute the betas. It works on
+  // an aligned copy of the betas, zero padded to lbfgs_variables_size(), which
+  // is followed by its workspace.
+  lbfgs_parameter_t param;
+  lbfgs_parameter_init(&param);
+  size_t workSize = lbfgsWorkSize(m_nBeta, param);
+  if (m_lbfgsWork.size() < workSize) m_lbfgsWork.resize(workSize);
+  size_t nVars = lbfgs_variables_size(m_nBeta);
+  double* x = alignPointer(m_lbfgsWork.data(), M_LBFGS_ALIGNMENT);
+  std::copy(m_beta.begin(), m_beta.begin() + m_nBeta, x);
+  std::fill(x + m_nBeta, x + nVars, 0.0);
+  int ret = lbfgs_ws(m_nBeta, x, &m_negloglik, _evalLogReg, NULL, this,
+    &param, x + nVars);
+  std::copy(x, x + m_nBeta, m_beta.begin());
+
+  // Lbfgs has many error codes (negative ret), which are not all real errors.
+  // Unfortunately, I do not know which are still OK, so I assume, that if the
+  // likelihood was set, it is somewhat acceptable (-> room for improvement).
+  if (ret < 0 && m_negloglik !=0) ret = 123;
+  if (ret >= 0) storeWarmStart();
+
   // Model could not be fitted
-  if (ret < 0) m_negloglik = m_errorVal;
+  else m_negloglik = m_errorVal;
+}
+
+
+template <class Family>
+size_t GLM<Family>::lbfgsWorkSize(size_t nBeta,
+  const lbfgs_parameter_t& param) {
+
+  return lbfgs_variables_size(nBeta) + lbfgs_workspace_size(nBeta, &param) +
+    M_LBFGS_ALIGNMENT / sizeof(double);
 }
 
 
-double GLM::getMSE() {
+template <class Family>
+double GLM<Family>::estimateCost(size_t nFeatures, bool testMSE) const {
+
+  double k = nFeatures + (m_intercept ? 1 : 0);
+  double n = m_D.XTrain->n_rows;
+
+  // Linear models update the Cholesky factor of the Gram matrix in O(k^2) in
+  // most cases, or set up the normal equations in O(n k^2). The other models
+  // take a few IRLS iterations of O(n k^2), or (logistic models with large k)
+  // more L-BFGS iterations of O(n k).
+  double cost = M_MODEL_OVERHEAD;
+  if (std::is_same<Family, Gaussian>::value)
+    cost += m_D.GramTrain != NULL ? k * k : n * k * k / 2;
+  else if (std::is_same<Family, Binomial>::value && k > M_IRLS_MAX_BETA)
+    cost += 50 * n * k;
+  else cost += 5 * n * k * k;
+
+  // The predictions on the test set (see getMSE())
+  if (testMSE && m_D.XTest != m_D.XTrain) {
+    if (std::is_same<Family, Gaussian>::value && m_D.GramTest != NULL)
+      cost += k * k;
+    else cost += m_D.XTest->n_rows * k;
+  }
+  return cost;
+}
+
+
+template <class Family>
+double GLM<Family>::getAICBoundOfExtensions() {
+
+  const double noBound = -std::numeric_limits<double>::infinity();
+  if (!std::is_same<Family, Gaussian>::value || m_D.GramTrain == NULL ||
+    m_negloglik == m_errorVal || m_cholComb.size() != m_nBeta) return noBound;
+
+  // The SSE of the model with all features of the subtree is a lower bound of
+  // the SSE of every model in it. These features are appended temporarily to
+  // the factor of the current combination.
+  const GramMatrix& G = *m_D.GramTrain;
+  size_t nCols = m_D.XTrain->n_cols;
+  if (m_gramRow.size() < nCols) m_gramRow.resize(nCols);
+  uint last = *std::max_element(m_cholComb.begin(), m_cholComb.end());
+  size_t dim = m_cholComb.size();
+  bool complete = true;
+  for (uint f = last + 1; f < nCols && complete; f++)
+    complete = appendToCholesky(f);
+  double sse = G.yty() - m_chol.rhsNormSq();
+  m_chol.truncate(dim);
+  m_cholComb.resize(dim);
+
+  // A (nearly) collinear feature gives no reliable bound
+  if (!complete || !(sse > 0)) return noBound;
+
+  // Every extension has at least one more coefficient. The SSE is lowered
+  // slightly to cover the rounding errors of the individual fits.
+  double n = G.getNRows();
+  double negloglik = n/2 * (log(2 * M_PI * sse * (1 - M_BOUND_TOL) / n) + 1);
+  return 2 * (negloglik + m_nBeta + 1 + Family::nExtraParams);
+}
+
+
+template <class Family>
+double GLM<Family>::getMSE() {
 
   // Model could not be fitted
   if (m_negloglik == m_errorVal) return m_errorVal;
@@ -52,27 +205,72 @@ double GLM::getMSE() {
   double n = m_D.XTest->n_rows;
 
   // shortcut for gaussian training set mse
-  if (m_D.noTestSet() && m_family == "gaussian")
+  if (m_D.noTestSet() && std::is_same<Family, Gaussian>::value)
     return exp(2/n * m_negloglik - 1) / (2 * M_PI);
 
+  // Linear predictions do not need to be computed explicitly
+  if (std::is_same<Family, Gaussian>::value && m_D.GramTest != NULL)
+    return getMSEGram();
+
+  // The predictions are computed column by column for blocks of rows, which
+  // reads the (column-major) test data contiguously.
+  if (m_block.size() < M_BLOCK_ROWS) m_block.resize(M_BLOCK_ROWS);
+  double* eta = &m_block[0];
+  const arma::mat& XT = *m_D.XTest;
+  const std::vector<double>& yT = *m_D.yTest;
+
   double sse = 0;
-  double eta, yHat;
-  for (size_t i = 0; i < n; i++) {
-    eta = 0;
-    for (size_t j = 0; j < m_nBeta; j++)
-      eta += (*m_D.XTest)(i, m_featureComb[j]) * m_beta[j];
+  for (size_t start = 0; start < n; start += M_BLOCK_ROWS) {
+    size_t len = std::min(M_BLOCK_ROWS, (size_t)n - start);
 
-    if (m_family == "gaussian") yHat = eta;
-    else if (m_family == "binomial") yHat = 1.0 / (1.0 + exp(-eta));
-    else return m_errorVal;
+    for (size_t i = 0; i < len; i++) eta[i] = 0.0;
+    for (size_t j = 0; j < m_nBeta; j++)
+      axpy(m_beta[j], XT.colptr(m_featureComb[j]) + start, eta, len);
 
-    sse += pow((*m_D.yTest)[i] - yHat, 2);
+    for (size_t i = 0; i < len; i++) {
+      double yHat = Family::linkInverse(eta[i]);
+      sse += (yT[start + i] - yHat) * (yT[start + i] - yHat);
+    }
   }
   return sse / n;
 }
 
 
-int GLM::computeOLS() {
+template <class Family>
+double GLM<Family>::getMSEGram() {
+
+  // The test SSE is (y - X b)'(y - X b) = y'y - 2 b'X'y + b'X'X b. On centered
+  // data, the intercept only enters through the mean residual
+  // c = mean(y) - b_0 - sum_j b_j mean(x_j), which adds n * c^2.
+  const GramMatrix& G = *m_D.GramTest;
+  size_t first = G.isCentered() ? 1 : 0;
+  double c = G.isCentered() ? G.yMean() - m_beta[0] : 0.0;
+
+  double sse = G.yty();
+  for (size_t j = first; j < m_nBeta; j++) {
+    uint f = m_featureComb[j];
+    double s = 0.0;
+    for (size_t l = first; l < j; l++)
+      s += m_beta[l] * G.XtX(f, m_featureComb[l]);
+    sse += m_beta[j] * (m_beta[j] * G.XtX(f, f) + 2 * (s - G.Xty(f)));
+    if (G.isCentered()) c -= m_beta[j] * G.mean(f);
+  }
+  sse += G.getNRows() * c * c;
+
+  // Rounding errors must not lead to a negative SSE
+  return std::max(sse, 0.0) / G.getNRows();
+}
+
+
+template <class Family>
+int GLM<Family>::computeOLS() {
+
+  // Use the precomputed Gram matrix if available, otherwise the normal
+  // equations of the selected columns. Collinear combinations are left to the
+  // more robust solver below.
+  if (m_D.GramTrain != NULL) {
+    if (computeOLSGram() == 0) return 0;
+  } else if (computeOLSPanel() == 0) return 0;
 
   arma::vec beta;
   arma::mat X = getXTrainSubset();
@@ -90,44 +288,363 @@ int GLM::computeOLS() {
 }
 
 
-// Helper function that computes the negLogLik for a given set of betas. It is
-// used by the optimizer to optimize the regression coefficients. For lbfgs to
-// work, it also needs to set the gradient vector to the memory address "g".
+template <class Family>
+int GLM<Family>::computeOLSPanel() {
+
+  preparePanel();
+  if (m_hessian.size() < m_nBeta * m_nBeta) {
+    m_hessian.resize(m_nBeta * m_nBeta);
+    m_gradient.resize(m_nBeta);
+    m_step.resize(m_nBeta);
+  }
+
+  const std::vector<double>& y = *m_D.yTrain;
+  size_t nRows = m_D.XTrain->n_rows;
+  double n = nRows;
+
+  // With an intercept (column 0), the other columns and y are centered like in
+  // the GramMatrix, which keeps the normal equations well conditioned.
+  double* mean = m_step.data();
+  double yMean = 0.0;
+  for (size_t j = 0; j < m_nBeta; j++) mean[j] = 0.0;
+  if (m_intercept) {
+    for (size_t j = 1; j < m_nBeta; j++) {
+      const double* x = panelCol(j);
+      double s = 0.0;
+      for (size_t i = 0; i < nRows; i++) s += x[i];
+      mean[j] = s / n;
+    }
+    for (size_t i = 0; i < nRows; i++) yMean += y[i];
+    yMean /= n;
+  }
+  double yty = 0.0;
+  for (size_t i = 0; i < nRows; i++) yty += (y[i] - yMean) * (y[i] - yMean);
+
+  // Build up the Cholesky factor of X'X row by row
+  m_hessChol.truncate(0);
+  for (size_t j = 0; j < m_nBeta; j++) {
+    double* a = &m_hessian[j * m_nBeta];
+    double b = 0.0;
+    if (m_intercept && j == 0) {
+      a[0] = n;
+    } else {
+      const double* x_j = panelCol(j);
+      for (size_t l = (m_intercept ? 1 : 0); l <= j; l++) {
+        const double* x_l = panelCol(l);
+        double s = 0.0;
+        for (size_t i = 0; i < nRows; i++)
+          s += (x_j[i] - mean[j]) * (x_l[i] - mean[l]);
+        a[l] = s;
+      }
+      if (m_intercept) a[0] = 0.0;
+      for (size_t i = 0; i < nRows; i++)
+        b += (x_j[i] - mean[j]) * (y[i] - yMean);
+    }
+    if (!m_hessChol.appendRow(a, a[j], b)) return -1;
+  }
+
+  double sse = yty - m_hessChol.rhsNormSq();
+  if (!(sse > 0)) return -1;
+
+  m_hessChol.solve(m_beta.data());
+
+  // On centered data, the intercept needs to be transformed back
+  if (m_intercept) {
+    m_beta[0] += yMean;
+    for (size_t j = 1; j < m_nBeta; j++) m_beta[0] -= m_beta[j] * mean[j];
+  }
+
+  m_negloglik = n/2 * (log(2 * M_PI * sse / n) + 1);
+  return 0;
+}
+
+
+template <class Family>
+bool GLM<Family>::appendToCholesky(uint feature) {
+
+  // Cross products of the new feature with those already in the factor
+  const GramMatrix& G = *m_D.GramTrain;
+  for (size_t i = 0; i < m_cholComb.size(); i++)
+    m_gramRow[i] = G.XtX(m_cholComb[i], feature);
+  if (!m_chol.appendRow(m_gramRow.data(), G.XtX(feature, feature),
+    G.Xty(feature))) return false;
+  m_cholComb.push_back(feature);
+  return true;
+}
+
+
+template <class Family>
+int GLM<Family>::computeOLSGram() {
+
+  const GramMatrix& G = *m_D.GramTrain;
+  if (m_gramRow.size() < m_nBeta) m_gramRow.resize(m_nBeta);
+
+  // If the new combination only swaps one feature of the factorized one (e.g.
+  // in revolving door order), that feature is removed by a downdate and the new
+  // one is appended. Otherwise the rows of the common prefix are kept, as the
+  // first rows of a Cholesky factor only depend on the first variables.
+  size_t removed = 0, nRemoved = 0;
+  if (m_cholComb.size() == m_nBeta) {
+    for (size_t j = 0; j < m_nBeta && nRemoved < 2; j++) {
+      if (!std::binary_search(m_featureComb.begin(), m_featureComb.end(),
+        m_cholComb[j])) {
+        removed = j;
+        nRemoved++;
+      }
+    }
+  }
+  if (nRemoved == 1) {
+    m_chol.removeRow(removed);
+    m_cholComb.erase(m_cholComb.begin() + removed);
+    for (uint f : m_featureComb) {
+      if (std::find(m_cholComb.begin(), m_cholComb.end(), f) ==
+        m_cholComb.end() && !appendToCholesky(f)) return -1;
+    }
+  } else {
+    size_t prefix = 0;
+    while (prefix < m_cholComb.size() && prefix < m_nBeta &&
+      m_cholComb[prefix] == m_featureComb[prefix]) prefix++;
+    m_chol.truncate(prefix);
+    m_cholComb.resize(prefix);
+    for (size_t j = prefix; j < m_nBeta; j++)
+      if (!appendToCholesky(m_featureComb[j])) return -1;
+  }
+
+  // The coefficients follow the order of the factor from now on
+  m_featureComb.assign(m_cholComb.begin(), m_cholComb.end());
+
+  // The residual sum of squares is y'y - y'X (X'X)^-1 X'y
+  double sse = G.yty() - m_chol.rhsNormSq();
+  if (!(sse > 0)) return -1;
+
+  m_chol.solve(m_beta.data());
+
+  // On centered data, the intercept needs to be transformed back
+  if (G.isCentered()) {
+    m_beta[0] += G.yMean();
+    for (size_t j = 1; j < m_nBeta; j++)
+      m_beta[0] -= m_beta[j] * G.mean(m_featureComb[j]);
+  }
+
+  double n = G.getNRows();
+  m_negloglik = n/2 * (log(2 * M_PI * sse / n) + 1);
+  return 0;
+}
+
+
+template <class Family>
+void GLM<Family>::preparePanel() {
+
+  size_t nRows = m_D.XTrain->n_rows;
+  if (m_panel.size() < nRows * m_nBeta) m_panel.resize(nRows * m_nBeta);
+
+  size_t prefix = 0;
+  while (prefix < m_panelComb.size() && prefix < m_nBeta &&
+    m_panelComb[prefix] == m_featureComb[prefix]) prefix++;
+  m_panelComb.resize(prefix);
+
+  for (size_t j = prefix; j < m_nBeta; j++) {
+    const double* x = m_D.XTrain->colptr(m_featureComb[j]);
+    std::copy(x, x + nRows, m_panel.begin() + j * nRows);
+    m_panelComb.push_back(m_featureComb[j]);
+  }
+}
+
+
+template <class Family>
+bool GLM<Family>::warmStart() {
+
+  for (size_t i = 0; i < m_nBeta; i++) m_beta[i] = 0.0;
+  if (m_nBeta < 2) return false;
+
+  // The fit of the parent combination (all but the last feature) is the best
+  // starting point, which is available in depth-first order. In size-first
+  // order, the previous combination of the same size usually only differs in
+  // its last feature, so its other coefficients are used.
+  for (size_t depth = m_nBeta - 1; depth <= m_nBeta; depth++) {
+    if (depth >= m_warmCombs.size()) break;
+    const std::vector<uint>& comb = m_warmCombs[depth];
+    if (comb.size() == depth && std::equal(comb.begin(),
+      comb.begin() + m_nBeta - 1, m_featureComb.begin())) {
+      for (size_t i = 0; i < m_nBeta - 1; i++)
+        m_beta[i] = m_warmBetas[depth][i];
+      return true;
+    }
+  }
+  return false;
+}
+
+
+template <class Family>
+void GLM<Family>::storeWarmStart() {
+
+  if (m_warmCombs.size() <= m_nBeta) {
+    m_warmCombs.resize(m_nBeta + 1);
+    m_warmBetas.resize(m_nBeta + 1);
+  }
+  m_warmCombs[m_nBeta].assign(m_featureComb.begin(), m_featureComb.end());
+  m_warmBetas[m_nBeta].assign(m_beta.begin(), m_beta.begin() + m_nBeta);
+}
+
+
+template <class Family>
+int GLM<Family>::computeIRLS(bool warm) {
+
+  if (m_hessian.size() < m_nBeta * m_nBeta) {
+    m_hessian.resize(m_nBeta * m_nBeta);
+    m_gradient.resize(m_nBeta);
+    m_step.resize(m_nBeta);
+  }
+
+  // A cold start begins with zero coefficients and the gradient of the start
+  // values, so that the first step gives the first weighted least squares fit
+  double nll = evalIRLS(m_beta.data(), !warm);
+  if (!std::isfinite(nll)) return -1;
+  double nllOld = warm ? nll : std::numeric_limits<double>::infinity();
+
+  for (size_t iter = 0; iter < M_IRLS_MAXIT; iter++) {
+
+    // Newton step: solve Hessian * step = -gradient via Cholesky
+    m_hessChol.truncate(0);
+    for (size_t j = 0; j < m_nBeta; j++) {
+      if (!m_hessChol.appendRow(&m_hessian[j * m_nBeta],
+        m_hessian[j * m_nBeta + j], -m_gradient[j])) return -1;
+    }
+    m_hessChol.solve(m_step.data());
+    for (size_t j = 0; j < m_nBeta; j++) m_beta[j] += m_step[j];
+    nll = evalIRLS(m_beta.data(), false);
+
+    // Step halving, if the new coefficients are invalid (e.g. a non-positive
+    // mean of a Gamma model)
+    for (size_t halving = 0; !std::isfinite(nll); halving++) {
+      if (halving == M_IRLS_MAXIT) return -1;
+      for (size_t j = 0; j < m_nBeta; j++) {
+        m_step[j] /= 2;
+        m_beta[j] -= m_step[j];
+      }
+      nll = evalIRLS(m_beta.data(), false);
+    }
+
+    // The same relative convergence criterion on the deviance as in glm()
+    if (fabs(nll - nllOld) / (fabs(nll) + 0.1) < M_IRLS_EPSILON) {
+      m_negloglik = Family::negLogLik(nll, m_D.XTrain->n_rows, m_responseSum);
+      return std::isfinite(m_negloglik) ? 0 : -1;
+    }
+    nllOld = nll;
+  }
+  // No convergence (e.g. due to separation)
+  return -1;
+}
+
+
+template <class Family>
+double GLM<Family>::evalIRLS(const double* beta, bool fromStart) {
+
+  const std::vector<double>& y = *m_D.yTrain;
+  size_t nRows = m_D.XTrain->n_rows;
+
+  for (size_t j = 0; j < m_nBeta * m_nBeta; j++) m_hessian[j] = 0.0;
+  for (size_t j = 0; j < m_nBeta; j++) m_gradient[j] = 0.0;
+
+  // Block workspace: eta, residuals and the weighted columns w * x_j
+  if (m_block.size() < (m_nBeta + 2) * M_BLOCK_ROWS)
+    m_block.resize((m_nBeta + 2) * M_BLOCK_ROWS);
+  double* eta = &m_block[0];
+  double* resid = &m_block[M_BLOCK_ROWS];
+  double* wx = &m_block[2 * M_BLOCK_ROWS];
+
+  double nll = 0.0;
+  for (size_t start = 0; start < nRows; start += M_BLOCK_ROWS) {
+    size_t len = std::min(M_BLOCK_ROWS, nRows - start);
+
+    // eta = X * beta, column by column
+    if (fromStart) {
+      for (size_t i = 0; i < len; i++)
+        eta[i] = Family::link(Family::startMean(y[start + i]));
+    } else {
+      for (size_t i = 0; i < len; i++) eta[i] = 0.0;
+      for (size_t j = 0; j < m_nBeta; j++)
+        axpy(beta[j], panelCol(j) + start, eta, len);
+    }
+
+    // The loss, the working weights W = muEta^2 / variance (stored in resid for
+    // now) and the working residuals of each observation, which replace eta.
+    // Like in glm(), observations without weight do not contribute. Logistic
+    // models have a vectorized kernel for this (see SimdKernels.h).
+    if (std::is_same<Family, Binomial>::value && !fromStart) {
+      nll += logisticBlock(eta, &y[start], len, eta, resid);
+    } else {
+      for (size_t i = 0; i < len; i++) {
+        double mu = Family::linkInverse(eta[i]);
+        double muEta = Family::muEta(eta[i], mu);
+        double var = Family::variance(mu);
+        nll += Family::loss(y[start + i], eta[i]);
+        if (var > 0 && muEta != 0) {
+          double r = (y[start + i] - mu) * muEta / var;
+          resid[i] = muEta * muEta / var;
+          eta[i] = fromStart ? r + resid[i] * eta[i] : r;
+        } else {
+          resid[i] = 0.0;
+          eta[i] = 0.0;
+        }
+      }
+    }
+
+    // Gradient and lower triangle of the Hessian X' W X
+    for (size_t j = 0; j < m_nBeta; j++) {
+      const double* x = panelCol(j) + start;
+      double* wx_j = wx + j * M_BLOCK_ROWS;
+      for (size_t i = 0; i < len; i++) wx_j[i] = resid[i] * x[i];
+      m_gradient[j] -= dotProduct(eta, x, len);
+
+      double* H_j = &m_hessian[j * m_nBeta];
+      for (size_t l = 0; l <= j; l++)
+        H_j[l] += dotProduct(wx_j, panelCol(l) + start, len);
+    }
+  }
+  return nll;
+}
+
+
+// Helper function that computes the logistic negLogLik for a given set of
+// betas. It is used by the optimizer to optimize the regression coefficients.
+// For lbfgs to work, it also needs to set the gradient vector to the memory
+// address "g".
 // For further reference on the used formulas for nll and the gradients see:
 // https://web.stanford.edu/class/archive/cs/cs109/cs109.1178/lectureHandouts/220-logistic-regression.pdf
 // page 2 bottom and page 3.
-double GLM::evalLogReg(const double* betaPtr, double* g, const size_t n,
+template <class Family>
+double GLM<Family>::evalLogReg(const double* betaPtr, double* g, const size_t n,
   const double step) {
 
   // References for shorter code and better readability
-  const arma::mat& X = *m_D.XTrain;
   const std::vector<double>& y = *m_D.yTrain;
+  size_t nRows = m_D.XTrain->n_rows;
 
   // reset space of gradient vector
   memset(g, 0, sizeof(double) * n);
 
-  // Iterate over observations i and sum up the negative log-likelihoods
+  if (m_block.size() < 2 * M_BLOCK_ROWS) m_block.resize(2 * M_BLOCK_ROWS);
+  double* eta = &m_block[0];
+  double* resid = &m_block[M_BLOCK_ROWS];
+
+  // Iterate over blocks of observations and sum up the negative log-likelihoods
   double nll = 0.0;
-  for (size_t i = 0; i < X.n_rows; i++) {
+  for (size_t start = 0; start < nRows; start += M_BLOCK_ROWS) {
+    size_t len = std::min(M_BLOCK_ROWS, nRows - start);
 
     // Iterate over data columns to compute eta_i = x_i %*% beta
-    double eta_i = 0.0;
+    for (size_t i = 0; i < len; i++) eta[i] = 0.0;
     for (size_t j = 0; j < m_nBeta; j++)
-      eta_i += X(i, m_featureComb[j]) * betaPtr[j];
-
-    // Compute prediction of observation i
-    double y_ihat =  1.0 / (1.0 + exp(-eta_i));
+      axpy(betaPtr[j], panelCol(j) + start, eta, len);
 
-    // If predictions exact 0 or 1 use small number to allow log.
-    if (y_ihat == 0.0) y_ihat = std::numeric_limits<double>::epsilon();
-    if (y_ihat == 1.0) y_ihat = 1 - std::numeric_limits<double>::epsilon();
+    // Negative log likelihoods and residuals of the predictions, several rows
+    // at once (see SimdKernels.h)
+    nll += logisticBlock(eta, &y[start], len, resid, NULL);
 
     // Also compute partial derivative of each beta_j and sum it up:
     for (size_t j = 0; j < m_nBeta; j++)
-      g[j] -= (y[i] - y_ihat) * X(i, m_featureComb[j]);
-
-    // Compute negative log likelihood of observation i and sum up
-    nll -=  y[i] * log(y_ihat) + (1 - y[i]) * log(1 - y_ihat);
+      g[j] -= dotProduct(resid, panelCol(j) + start, len);
   }
 
   // Return the negative log Likelihood (which is to be minimized)
@@ -164,3 +681,9 @@ double GLM::evalLogReg(const double* betaPtr, double* g, const size_t n,
 //   // Compute and return the negative log likelihood
 //   return -arma::as_scalar(y.t() * log(yHat) + (1 - y).t() * log(1 - yHat));
 // }
+
+
+template class GLM<Gaussian>;
+template class GLM<Binomial>;
+template class GLM<Poisson>;
+template class GLM<Gamma>;
@@ -2,48 +2,117 @@
 
 #include <vector>
 #include <limits>
+#include <algorithm>
 #include <math.h>
 #include <string>
 #include <string.h>
+#include <type_traits>
+#include <stdint.h>
 
 #include "DataSet.h"
+#include "Family.h"
+#include "Cholesky.h"
+#include "SimdKernels.h"
 #include "lbfgs.h"
 
 
 typedef unsigned int  uint;
 
+// Logistic models with up to this many coefficients are fitted by IRLS (Newton)
+// with an explicit Hessian, larger ones directly by L-BFGS. The other families
+// are always fitted by IRLS.
+const size_t M_IRLS_MAX_BETA = 16;
+// Maximum number of iterations and convergence tolerance of IRLS (like the
+// defaults of glm.control() in R)
+const size_t M_IRLS_MAXIT = 25;
+const double M_IRLS_EPSILON = 1e-8;
+// Row loops over the data are processed in blocks of this many rows, so that
+// all intermediate vectors of a block stay in the L1 cache.
+const size_t M_BLOCK_ROWS = 256;
+// Alignment in bytes of the variables of L-BFGS, one AVX-512 vector (the
+// vectorized arithmetic of lbfgs.c needs at least 16)
+const size_t M_LBFGS_ALIGNMENT = 64;
+// Relative tolerance of the SSE bound in getAICBoundOfExtensions()
+const double M_BOUND_TOL = 1e-8;
+// Operations per model that do not depend on its size (estimateCost())
+const double M_MODEL_OVERHEAD = 100;
+
+// Rounds ptr up to the next multiple of alignment (a power of two)
+inline double* alignPointer(double* ptr, size_t alignment) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  address = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  return reinterpret_cast<double*>(address);
+}
+
+// A GLM fits models of the given family (Family.h) for one feature
+// combination after another.
+template <class Family>
 class GLM {
 
 protected:
   DataSet m_D;
   std::vector<uint> m_featureComb;
-  std::string m_family;
-  std::string m_performanceMeasure;
   bool m_intercept;
   double m_errorVal;
   size_t m_nBeta;
-  double* m_beta;
+  std::vector<double> m_beta;
   double m_negloglik;
+  // Sum of Family::responseTerm() over the training responses
+  double m_responseSum;
+  // Workspace of the Gram matrix based OLS. The factor is kept between fits,
+  // m_cholComb holds the features of its rows.
+  CholeskyFactor m_chol;
+  std::vector<uint> m_cholComb;
+  std::vector<double> m_gramRow;
+  // Workspace of IRLS
+  CholeskyFactor m_hessChol;
+  std::vector<double> m_hessian;
+  std::vector<double> m_gradient;
+  std::vector<double> m_step;
+  // Working space of L-BFGS (see lbfgs_ws()), preceded by its variables
+  // (see lbfgsWorkSize())
+  std::vector<double> m_lbfgsWork;
+  // Contiguous copy of the training columns of m_featureComb (column-major),
+  // m_panelComb holds the features of its columns
+  std::vector<double> m_panel;
+  std::vector<uint> m_panelComb;
+  // Intermediate values of a block of rows
+  std::vector<double> m_block;
+  // Coefficients of the last iterative fit per number of coefficients, which
+  // serve as starting values for related combinations
+  std::vector<std::vector<uint>> m_warmCombs;
+  std::vector<std::vector<double>> m_warmBetas;
 
 public:
   // Initializer only defines the modeling setup. A feature combination needs
   // to be set separately before any further evaluation.
-  GLM(const DataSet& D, std::string family, std::string performanceMeasure,
-    bool intercept, double errorVal)
-    : m_D(D), m_family(family), m_performanceMeasure(performanceMeasure),
-      m_intercept(intercept), m_errorVal(errorVal), m_nBeta(D.XTrain->n_cols),
-      m_negloglik(0) {}
-  std::string getFamily() { return m_family;}
-  double getPerformance() {
-    if (m_performanceMeasure == "AIC") return getAIC();
-    else if (m_performanceMeasure == "MSE") return getMSE();
-    else return m_errorVal;
-  }
+  GLM(const DataSet& D, bool intercept, double errorVal)
+    : m_D(D), m_intercept(intercept), m_errorVal(errorVal),
+      m_nBeta(D.XTrain->n_cols), m_negloglik(0), m_responseSum(0) {}
+  // The data can be replaced by a copy (see DataReplica), which keeps the
+  // workspace of the model
+  const DataSet& getDataSet() const { return m_D; }
+  void setDataSet(const DataSet& D) { m_D = D; }
+  // Allocates all buffers for combinations of up to maxFeatures features, so
+  // that fitting models does not allocate memory anymore.
+  void allocateWorkspace(size_t maxFeatures);
+  // Rough number of operations to fit a model of nFeatures features and to
+  // compute its test set MSE (if testMSE), by which the search is split into
+  // batches of equal cost
+  double estimateCost(size_t nFeatures, bool testMSE) const;
   double getAIC() {
     if (m_negloglik == m_errorVal) return m_errorVal;
-    else return 2 * (m_negloglik + m_nBeta + (m_family == "gaussian" ? 1 : 0));
+    else return 2 * (m_negloglik + m_nBeta + Family::nExtraParams);
   }
+  // Lower bound of the AIC of all extensions of the current combination by
+  // features after its last one (its subtree in depth-first order), as the SSE
+  // of a linear model cannot increase with more features. Needs a previous
+  // successful fit() from the Gram matrix, otherwise (and for other families)
+  // it is -Inf.
+  double getAICBoundOfExtensions();
   double getMSE();
+  // Test set MSE of a linear model from the test Gram matrix in O(k^2)
+  double getMSEGram();
   void setFeatureCombination(const std::vector<uint>& new_comb);
   void fit();
 
@@ -56,12 +125,48 @@ public:
     return m_D.XTrain->cols(arma::Col<uint>(m_featureComb));
   }
   int computeOLS();
+  // OLS from the precomputed Gram matrix in O(k^3) instead of O(n * k^2). The
+  // factor of the previous combination is updated instead, if only a prefix is
+  // kept or a single feature is swapped. In most cases (depth-first or
+  // revolving door order) this takes only O(k^2).
+  int computeOLSGram();
+  bool appendToCholesky(uint feature);
+  // OLS from the normal equations of the (centered) data columns in the panel,
+  // if there is no precomputed Gram matrix
+  int computeOLSPanel();
 
-  // Logistic Regression functions:
+  // Gathers the training columns of m_featureComb into m_panel. Columns of a
+  // common prefix with the previous combination are kept.
+  void preparePanel();
+  const double* panelCol(size_t j) const {
+    return &m_panel[j * m_D.XTrain->n_rows];
+  }
+  // Functions of the other families:
+  // Sets m_beta to the coefficients of a cached related fit, with zero for the
+  // remaining feature. Returns false (and zeros) if there is none.
+  bool warmStart();
+  void storeWarmStart();
+  // Iteratively reweighted least squares (Fisher scoring, which is Newton's
+  // method for the canonical links), starting from m_beta if warm, otherwise
+  // from the linear predictor of Family::startMean(). Steps to invalid
+  // coefficients are halved like in glm(). Returns a negative value if it did
+  // not converge.
+  int computeIRLS(bool warm);
+  // Sets the gradient of the loss and the Fisher information X' W X in beta
+  // (one pass over the data) and returns the loss. fromStart evaluates the
+  // linear predictor of Family::startMean() instead, with the gradient chosen
+  // so that the next step from zero solves the first weighted least squares
+  // problem of glm().
+  double evalIRLS(const double* beta, bool fromStart);
+  // Logistic regression by L-BFGS:
+  // The length of m_lbfgsWork for nBeta coefficients, including the slack for
+  // aligning the variables to M_LBFGS_ALIGNMENT
+  static size_t lbfgsWorkSize(size_t nBeta, const lbfgs_parameter_t& param);
   // The target function to be optimized in the form that lbfgs takes it
   static double _evalLogReg(void* instance, const double* betaPtr, double* g,
     const int n, const double step)	{
-    return reinterpret_cast<GLM*>(instance)->evalLogReg(betaPtr, g, n, step);
+    return reinterpret_cast<GLM<Family>*>(instance)->evalLogReg(betaPtr, g, n,
+      step);
   }
   // The main lbfgs function. Sets the gradient values at pointer.
   // Returns target function value.
@@ -69,3 +174,8 @@ public:
     const double step);
 
 };
+
+// Linear models are fitted by least squares, logistic models by IRLS or L-BFGS,
+// and the other families by IRLS
+template <> void GLM<Gaussian>::fit();
+template <> void GLM<Binomial>::fit();
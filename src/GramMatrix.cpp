@@ -0,0 +1,52 @@
+#include "GramMatrix.h"
+
+
+GramMatrix::GramMatrix(const arma::mat& X, const std::vector<double>& y,
+  bool centered) : m_nRows(X.n_rows), m_nCols(X.n_cols), m_centered(centered),
+  m_XtX(m_nCols * m_nCols, 0.0), m_Xty(m_nCols, 0.0), m_yty(0.0),
+  m_means(m_nCols, 0.0), m_yMean(0.0) {
+
+  if (m_centered && m_nRows > 0) {
+    for (size_t j = 1; j < m_nCols; j++) {
+      const double* xj = X.colptr(j);
+      double s = 0.0;
+      for (size_t i = 0; i < m_nRows; i++) s += xj[i];
+      m_means[j] = s / m_nRows;
+    }
+    for (size_t i = 0; i < m_nRows; i++) m_yMean += y[i];
+    m_yMean /= m_nRows;
+  }
+
+  // Column by column cross products of the (centered) data. The intercept
+  // column is handled separately if the data is centered.
+  size_t first = m_centered ? 1 : 0;
+  for (size_t a = first; a < m_nCols; a++) {
+    const double* xa = X.colptr(a);
+    double ma = m_means[a];
+    for (size_t b = a; b < m_nCols; b++) {
+      const double* xb = X.colptr(b);
+      double mb = m_means[b];
+      double s = 0.0;
+      for (size_t i = 0; i < m_nRows; i++) s += (xa[i] - ma) * (xb[i] - mb);
+      m_XtX[a * m_nCols + b] = s;
+      m_XtX[b * m_nCols + a] = s;
+    }
+    double s = 0.0;
+    for (size_t i = 0; i < m_nRows; i++) s += (xa[i] - ma) * (y[i] - m_yMean);
+    m_Xty[a] = s;
+  }
+  if (m_centered) m_XtX[0] = m_nRows;
+
+  for (size_t i = 0; i < m_nRows; i++)
+    m_yty += (y[i] - m_yMean) * (y[i] - m_yMean);
+}
+
+
+bool GramMatrix::worthwhile(size_t nRows, size_t nCols, size_t nCombinations,
+  size_t k) {
+
+  double gramSize = (double)nCols * nCols;
+  bool fitsMemory = gramSize <= (double)nRows * nCols || gramSize <= 1 << 24;
+  bool paysOff = gramSize / 2 <= (double)nCombinations * (k + 1) * (k + 1);
+  return fitsMemory && paysOff;
+}
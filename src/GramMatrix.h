@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "Platform.h"
+
+
+typedef unsigned int  uint;
+
+// A GramMatrix holds the sufficient statistics X'X, X'y and y'y of a linear
+// model on a data set. They are computed once per search, so that every least
+// squares fit afterwards only works on small k x k sub-matrices, independent of
+// the number of observations.
+//
+// If centered is set, column 0 of X is assumed to be the intercept and all
+// other columns as well as y are centered first. This avoids the loss of
+// precision of X'X for features with a large mean. The intercept is then
+// orthogonal to all features: X'X(0, 0) = n, X'X(0, j) = 0 and X'y(0) = 0.
+class GramMatrix {
+
+  size_t m_nRows;
+  size_t m_nCols;
+  bool m_centered;
+  std::vector<double> m_XtX;
+  std::vector<double> m_Xty;
+  double m_yty;
+  std::vector<double> m_means;
+  double m_yMean;
+
+public:
+  GramMatrix(const arma::mat& X, const std::vector<double>& y, bool centered);
+
+  size_t getNRows() const { return m_nRows; }
+  bool isCentered() const { return m_centered; }
+  double XtX(uint i, uint j) const { return m_XtX[i * m_nCols + j]; }
+  double Xty(uint i) const { return m_Xty[i]; }
+  double yty() const { return m_yty; }
+  double mean(uint i) const { return m_means[i]; }
+  double yMean() const { return m_yMean; }
+
+  // Computing X'X takes about n * nCols^2 / 2 operations and nCols^2 doubles of
+  // memory. It only pays off, if that is small compared to the search itself
+  // (about nCombinations * n * k^2) and does not take more memory than X.
+  static bool worthwhile(size_t nRows, size_t nCols, size_t nCombinations,
+    size_t k);
+};
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "Numa.h"
+
+
+// Parses a Linux CPU (or node) list like "0-3,8,10-11"
+static std::vector<uint> parseCpuList(const std::string& list) {
+
+  std::vector<uint> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n") continue;
+    size_t dash = range.find('-');
+    uint first = std::stoul(range.substr(0, dash));
+    uint last = dash == std::string::npos ? first :
+      std::stoul(range.substr(dash + 1));
+    for (uint cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+
+NumaTopology::NumaTopology() {
+
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  bool known = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+  // The node numbers may have gaps, e.g. "0,2-3"
+  std::ifstream possible("/sys/devices/system/node/possible");
+  std::string nodeList;
+  std::vector<uint> nodes;
+  if (possible && std::getline(possible, nodeList)) {
+    try {
+      nodes = parseCpuList(nodeList);
+    } catch (std::exception&) {}
+  }
+
+  for (uint node : nodes) {
+    std::ifstream in(("/sys/devices/system/node/node" + std::to_string(node) +
+      "/cpulist").c_str());
+    std::string list;
+    std::vector<uint> cpus;
+    if (!in || !std::getline(in, list)) continue;
+    try {
+      for (uint cpu : parseCpuList(list))
+        if (!known || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+          cpus.push_back(cpu);
+    } catch (std::exception&) {
+      continue;
+    }
+    if (cpus.empty()) continue;
+    for (uint cpu : cpus) {
+      if (cpu >= m_cpuNode.size()) m_cpuNode.resize(cpu + 1, -1);
+      m_cpuNode[cpu] = m_nodeCpus.size();
+    }
+    m_nodeCpus.push_back(cpus);
+  }
+#endif
+
+  // Without any information, all CPUs are on a single node
+  if (m_nodeCpus.empty()) {
+    uint nCpus = std::max(std::thread::hardware_concurrency(), 1u);
+    m_nodeCpus.resize(1);
+    for (uint cpu = 0; cpu < nCpus; cpu++) m_nodeCpus[0].push_back(cpu);
+    m_cpuNode.assign(nCpus, 0);
+  }
+
+  size_t maxCpus = 0;
+  for (const std::vector<uint>& cpus : m_nodeCpus)
+    maxCpus = std::max(maxCpus, cpus.size());
+  for (size_t i = 0; i < maxCpus; i++)
+    for (const std::vector<uint>& cpus : m_nodeCpus)
+      if (i < cpus.size()) m_workerCpus.push_back(cpus[i]);
+}
+
+
+size_t NumaTopology::currentNode() const {
+
+#ifdef __linux__
+  int cpu = sched_getcpu();
+  if (cpu >= 0 && (size_t)cpu < m_cpuNode.size() && m_cpuNode[cpu] >= 0)
+    return m_cpuNode[cpu];
+#endif
+  return 0;
+}
+
+
+bool pinCurrentThread(uint cpu) {
+
+#ifdef __linux__
+  if (cpu >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+
+DataReplica::DataReplica(const DataSet& source)
+  : XTrain(*source.XTrain), yTrain(*source.yTrain), D(source) {
+
+  D.XTrain = &XTrain;
+  D.yTrain = &yTrain;
+  if (source.XTest == source.XTrain && source.yTest == source.yTrain) {
+    D.XTest = &XTrain;
+    D.yTest = &yTrain;
+  } else {
+    XTest = *source.XTest;
+    yTest = *source.yTest;
+    D.XTest = &XTest;
+    D.yTest = &yTest;
+  }
+
+  if (source.GramTrain != NULL) {
+    GramTrain.reset(new GramMatrix(*source.GramTrain));
+    D.GramTrain = GramTrain.get();
+  }
+  if (source.GramTest != NULL) {
+    GramTest.reset(new GramMatrix(*source.GramTest));
+    D.GramTest = GramTest.get();
+  }
+}
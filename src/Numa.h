@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#include "DataSet.h"
+
+
+typedef unsigned int  uint;
+
+// The NUMA nodes of the machine and the CPUs of each node that this process
+// may run on. On Linux, they are read from /sys/devices/system/node, elsewhere
+// (or if that fails) all CPUs form a single node.
+class NumaTopology {
+
+  std::vector<std::vector<uint>> m_nodeCpus;
+  // The node of each CPU (by CPU number), -1 if unknown
+  std::vector<int> m_cpuNode;
+  // The CPUs alternating between the nodes, i.e. the first CPU of each node,
+  // then the second of each node, ... Workers are pinned in this order, so
+  // that few threads already use the memory bandwidth of all nodes.
+  std::vector<uint> m_workerCpus;
+
+public:
+  NumaTopology();
+
+  size_t getNNodes() const { return m_nodeCpus.size(); }
+  // The CPU of worker thread w
+  uint workerCpu(size_t w) const {
+    return m_workerCpus[w % m_workerCpus.size()];
+  }
+  // The node of the CPU the calling thread currently runs on, or 0 if unknown
+  size_t currentNode() const;
+};
+
+// Binds the calling thread to a single CPU. Returns false, if that is not
+// supported or not allowed.
+bool pinCurrentThread(uint cpu);
+
+// A copy of the data of a DataSet, including its Gram matrices. Created by a
+// thread on a NUMA node, its memory is local to that node (first touch), so
+// that the threads of the node do not read the data of another node.
+struct DataReplica {
+
+  arma::mat XTrain;
+  std::vector<double> yTrain;
+  arma::mat XTest;
+  std::vector<double> yTest;
+  std::unique_ptr<GramMatrix> GramTrain;
+  std::unique_ptr<GramMatrix> GramTest;
+  // Points to the copies above
+  DataSet D;
+
+  explicit DataReplica(const DataSet& source);
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+// The environment the search engine runs in. By default it is part of the R
+// package, which provides Armadillo, the console and user interrupts. Compiled
+// with ES_STANDALONE (see CMakeLists.txt), the engine only depends on
+// Armadillo and the standard library, e.g. for the command line driver.
+#ifdef ES_STANDALONE
+
+#include <csignal>
+#include <iostream>
+
+#include <armadillo>
+
+
+// Set by the SIGINT handler of the host program (see installInterruptHandler())
+inline volatile std::sig_atomic_t& interruptFlag() {
+  static volatile std::sig_atomic_t flag = 0;
+  return flag;
+}
+
+// The progress goes to stderr, which keeps stdout free for the results
+inline std::ostream& consoleOut() { return std::cerr; }
+inline std::ostream& consoleErr() { return std::cerr; }
+inline bool userInterrupted() { return interruptFlag() != 0; }
+
+// Makes Ctrl+C abort a running search like an interrupt in R, after which the
+// best models so far (and a final checkpoint) are still written
+inline void installInterruptHandler() {
+  std::signal(SIGINT, [](int) { interruptFlag() = 1; });
+}
+
+#else
+
+#include <RcppArmadillo.h>
+
+
+inline std::ostream& consoleOut() { return Rcpp::Rcout; }
+inline std::ostream& consoleErr() { return Rcpp::Rcerr; }
+
+// User interrupt checks that are ensured to be Toplevel
+inline void checkInterruptFn(void *dummy) { R_CheckUserInterrupt(); }
+inline bool userInterrupted() {
+  return (R_ToplevelExec(checkInterruptFn, NULL) == FALSE);
+}
+
+#endif
@@ -12,8 +12,8 @@ Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
 // ExhaustiveSearchCpp
-Rcpp::List ExhaustiveSearchCpp(const arma::mat& XInput, const std::vector<double>& yInput, const arma::mat& XTestSet, const std::vector<double>& yTestSet, std::string family, std::string performanceMeasure, bool intercept, size_t combsUpTo, size_t nResults, size_t nThreads, double errorVal, bool quietly);
-RcppExport SEXP _ExhaustiveSearch_ExhaustiveSearchCpp(SEXP XInputSEXP, SEXP yInputSEXP, SEXP XTestSetSEXP, SEXP yTestSetSEXP, SEXP familySEXP, SEXP performanceMeasureSEXP, SEXP interceptSEXP, SEXP combsUpToSEXP, SEXP nResultsSEXP, SEXP nThreadsSEXP, SEXP errorValSEXP, SEXP quietlySEXP) {
+Rcpp::List ExhaustiveSearchCpp(const arma::mat& XInput, const std::vector<double>& yInput, const arma::mat& XTestSet, const std::vector<double>& yTestSet, std::string family, std::string performanceMeasure, bool intercept, size_t combsUpTo, size_t nResults, size_t nThreads, std::string enumeration, size_t rankStart, size_t rankEnd, std::string checkpointFile, size_t checkpointInterval, bool resume, bool pruning, std::string resultFile, std::string batchCosts, std::string backend, bool pinThreads, double errorVal, bool quietly);
+RcppExport SEXP _ExhaustiveSearch_ExhaustiveSearchCpp(SEXP XInputSEXP, SEXP yInputSEXP, SEXP XTestSetSEXP, SEXP yTestSetSEXP, SEXP familySEXP, SEXP performanceMeasureSEXP, SEXP interceptSEXP, SEXP combsUpToSEXP, SEXP nResultsSEXP, SEXP nThreadsSEXP, SEXP enumerationSEXP, SEXP rankStartSEXP, SEXP rankEndSEXP, SEXP checkpointFileSEXP, SEXP checkpointIntervalSEXP, SEXP resumeSEXP, SEXP pruningSEXP, SEXP resultFileSEXP, SEXP batchCostsSEXP, SEXP backendSEXP, SEXP pinThreadsSEXP, SEXP errorValSEXP, SEXP quietlySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -27,15 +27,77 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< size_t >::type combsUpTo(combsUpToSEXP);
     Rcpp::traits::input_parameter< size_t >::type nResults(nResultsSEXP);
     Rcpp::traits::input_parameter< size_t >::type nThreads(nThreadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type enumeration(enumerationSEXP);
+    Rcpp::traits::input_parameter< size_t >::type rankStart(rankStartSEXP);
+    Rcpp::traits::input_parameter< size_t >::type rankEnd(rankEndSEXP);
+    Rcpp::traits::input_parameter< std::string >::type checkpointFile(checkpointFileSEXP);
+    Rcpp::traits::input_parameter< size_t >::type checkpointInterval(checkpointIntervalSEXP);
+    Rcpp::traits::input_parameter< bool >::type resume(resumeSEXP);
+    Rcpp::traits::input_parameter< bool >::type pruning(pruningSEXP);
+    Rcpp::traits::input_parameter< std::string >::type resultFile(resultFileSEXP);
+    Rcpp::traits::input_parameter< std::string >::type batchCosts(batchCostsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type backend(backendSEXP);
+    Rcpp::traits::input_parameter< bool >::type pinThreads(pinThreadsSEXP);
     Rcpp::traits::input_parameter< double >::type errorVal(errorValSEXP);
     Rcpp::traits::input_parameter< bool >::type quietly(quietlySEXP);
-    rcpp_result_gen = Rcpp::wrap(ExhaustiveSearchCpp(XInput, yInput, XTestSet, yTestSet, family, performanceMeasure, intercept, combsUpTo, nResults, nThreads, errorVal, quietly));
+    rcpp_result_gen = Rcpp::wrap(ExhaustiveSearchCpp(XInput, yInput, XTestSet, yTestSet, family, performanceMeasure, intercept, combsUpTo, nResults, nThreads, enumeration, rankStart, rankEnd, checkpointFile, checkpointInterval, resume, pruning, resultFile, batchCosts, backend, pinThreads, errorVal, quietly));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ReadResultFilesCpp
+Rcpp::List ReadResultFilesCpp(const std::vector<std::string>& files, double n, double maxPerformance);
+RcppExport SEXP _ExhaustiveSearch_ReadResultFilesCpp(SEXP filesSEXP, SEXP nSEXP, SEXP maxPerformanceSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type files(filesSEXP);
+    Rcpp::traits::input_parameter< double >::type n(nSEXP);
+    Rcpp::traits::input_parameter< double >::type maxPerformance(maxPerformanceSEXP);
+    rcpp_result_gen = Rcpp::wrap(ReadResultFilesCpp(files, n, maxPerformance));
+    return rcpp_result_gen;
+END_RCPP
+}
+// EstimateRuntimeCpp
+Rcpp::List EstimateRuntimeCpp(const arma::mat& XInput, const std::vector<double>& yInput, const arma::mat& XTestSet, const std::vector<double>& yTestSet, std::string family, std::string performanceMeasure, bool intercept, size_t combsUpTo, std::string enumeration, size_t nSamples, double seed);
+RcppExport SEXP _ExhaustiveSearch_EstimateRuntimeCpp(SEXP XInputSEXP, SEXP yInputSEXP, SEXP XTestSetSEXP, SEXP yTestSetSEXP, SEXP familySEXP, SEXP performanceMeasureSEXP, SEXP interceptSEXP, SEXP combsUpToSEXP, SEXP enumerationSEXP, SEXP nSamplesSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type XInput(XInputSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type yInput(yInputSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type XTestSet(XTestSetSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type yTestSet(yTestSetSEXP);
+    Rcpp::traits::input_parameter< std::string >::type family(familySEXP);
+    Rcpp::traits::input_parameter< std::string >::type performanceMeasure(performanceMeasureSEXP);
+    Rcpp::traits::input_parameter< bool >::type intercept(interceptSEXP);
+    Rcpp::traits::input_parameter< size_t >::type combsUpTo(combsUpToSEXP);
+    Rcpp::traits::input_parameter< std::string >::type enumeration(enumerationSEXP);
+    Rcpp::traits::input_parameter< size_t >::type nSamples(nSamplesSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(EstimateRuntimeCpp(XInput, yInput, XTestSet, yTestSet, family, performanceMeasure, intercept, combsUpTo, enumeration, nSamples, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// EnumerateCombinationsCpp
+Rcpp::List EnumerateCombinationsCpp(size_t N, size_t k, std::string enumeration);
+RcppExport SEXP _ExhaustiveSearch_EnumerateCombinationsCpp(SEXP NSEXP, SEXP kSEXP, SEXP enumerationSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< size_t >::type N(NSEXP);
+    Rcpp::traits::input_parameter< size_t >::type k(kSEXP);
+    Rcpp::traits::input_parameter< std::string >::type enumeration(enumerationSEXP);
+    rcpp_result_gen = Rcpp::wrap(EnumerateCombinationsCpp(N, k, enumeration));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_ExhaustiveSearch_ExhaustiveSearchCpp", (DL_FUNC) &_ExhaustiveSearch_ExhaustiveSearchCpp, 12},
+    {"_ExhaustiveSearch_ExhaustiveSearchCpp", (DL_FUNC) &_ExhaustiveSearch_ExhaustiveSearchCpp, 23},
+    {"_ExhaustiveSearch_ReadResultFilesCpp", (DL_FUNC) &_ExhaustiveSearch_ReadResultFilesCpp, 3},
+    {"_ExhaustiveSearch_EstimateRuntimeCpp", (DL_FUNC) &_ExhaustiveSearch_EstimateRuntimeCpp, 11},
+    {"_ExhaustiveSearch_EnumerateCombinationsCpp", (DL_FUNC) &_ExhaustiveSearch_EnumerateCombinationsCpp, 3},
     {NULL, NULL, 0}
 };
 
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+
+#include "ResultFile.h"
+
+
+// File layout (native byte order): magic, version, the setup (number of
+// features, maximal combination size and enumeration order) and the records.
+static const char M_MAGIC[8] = {'E', 'S', 'R', 'E', 'S', 'U', 'L', 'T'};
+static const uint32_t M_VERSION = 1;
+
+
+template <class T>
+static void writeValue(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+static void readValue(std::ifstream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+
+ResultWriter::ResultWriter(const std::string& file, uint32_t nFeatures,
+  uint32_t combsUpTo, uint32_t order)
+  : m_file(file), m_out(file.c_str(), std::ios::binary | std::ios::trunc),
+    m_failed(false) {
+
+  m_buffer.reserve(M_RESULT_BUFFER_RECORDS);
+  m_out.write(M_MAGIC, sizeof(M_MAGIC));
+  writeValue(m_out, M_VERSION);
+  writeValue(m_out, nFeatures);
+  writeValue(m_out, combsUpTo);
+  writeValue(m_out, order);
+  m_failed = !m_out;
+}
+
+
+void ResultWriter::flush() {
+
+  if (!m_failed) {
+    m_out.write(reinterpret_cast<const char*>(m_buffer.data()),
+      m_buffer.size() * sizeof(ResultRecord));
+    m_out.flush();
+    m_failed = !m_out;
+  }
+  m_buffer.clear();
+}
+
+
+// Orders records by performance (ties by rank), so that the top of a
+// std::priority_queue is the worst record
+static bool better(const ResultRecord& a, const ResultRecord& b) {
+  return a.performance < b.performance ||
+    (a.performance == b.performance && a.rank < b.rank);
+}
+
+
+void readResultFiles(const std::vector<std::string>& files, size_t n,
+  double maxPerformance, std::vector<ResultRecord>& records,
+  uint32_t& nFeatures, uint32_t& combsUpTo, uint32_t& order) {
+
+  std::priority_queue<ResultRecord, std::vector<ResultRecord>,
+    bool (*)(const ResultRecord&, const ResultRecord&)> best(better);
+  std::vector<ResultRecord> block(M_RESULT_BUFFER_RECORDS);
+
+  for (size_t f = 0; f < files.size(); f++) {
+    const std::string& file = files[f];
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot read result file " + file);
+
+    char magic[sizeof(M_MAGIC)];
+    uint32_t version = 0, fileFeatures = 0, fileCombsUpTo = 0, fileOrder = 0;
+    in.read(magic, sizeof(M_MAGIC));
+    readValue(in, version);
+    readValue(in, fileFeatures);
+    readValue(in, fileCombsUpTo);
+    readValue(in, fileOrder);
+    if (!in || !std::equal(magic, magic + sizeof(M_MAGIC), M_MAGIC) ||
+      version != M_VERSION)
+      throw std::runtime_error(file + " is not a valid result file.");
+    if (f == 0) {
+      nFeatures = fileFeatures;
+      combsUpTo = fileCombsUpTo;
+      order = fileOrder;
+    } else if (fileFeatures != nFeatures || fileCombsUpTo != combsUpTo ||
+      fileOrder != order)
+      throw std::runtime_error(
+        "The result files belong to different searches.");
+
+    // Read block by block, a (partially written) last record is ignored
+    while (in) {
+      in.read(reinterpret_cast<char*>(block.data()),
+        block.size() * sizeof(ResultRecord));
+      size_t nRead = in.gcount() / sizeof(ResultRecord);
+      for (size_t i = 0; i < nRead && n > 0; i++) {
+        if (!(block[i].performance <= maxPerformance)) continue;
+        if (best.size() < n) best.push(block[i]);
+        else if (better(block[i], best.top())) {
+          best.pop();
+          best.push(block[i]);
+        }
+      }
+    }
+  }
+
+  records.resize(best.size());
+  for (size_t i = records.size(); i-- > 0;) {
+    records[i] = best.top();
+    best.pop();
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// A result file holds the rank (in the enumeration order) and performance of
+// every model evaluated by one thread. Records have a fixed width, so the files
+// can be read in blocks or at any position without loading them completely.
+struct ResultRecord {
+  uint64_t rank;
+  double performance;
+};
+static_assert(sizeof(ResultRecord) == 16, "Records are written as is");
+
+// Number of records a ResultWriter collects before they are written
+const size_t M_RESULT_BUFFER_RECORDS = 1 << 16;
+
+// Appends records to a result file through a buffer. Write errors do not throw,
+// as the writer is used within the search threads. They are reported by
+// failed() instead, and no further records are written.
+class ResultWriter {
+
+  std::string m_file;
+  std::ofstream m_out;
+  std::vector<ResultRecord> m_buffer;
+  bool m_failed;
+
+public:
+  // Creates (or truncates) file and writes the header with the setup of the
+  // search, which the ranks refer to
+  ResultWriter(const std::string& file, uint32_t nFeatures, uint32_t combsUpTo,
+    uint32_t order);
+  ~ResultWriter() { flush(); }
+
+  void add(uint64_t rank, double performance) {
+    m_buffer.push_back({rank, performance});
+    if (m_buffer.size() == M_RESULT_BUFFER_RECORDS) flush();
+  }
+  void flush();
+  bool failed() const { return m_failed; }
+  const std::string& getFile() const { return m_file; }
+};
+
+// Reads the records of the given result files with a performance of at most
+// maxPerformance. Only the best n of them are kept, sorted by performance. The
+// setup of the files (see ResultWriter) is returned by the last arguments.
+// Throws a std::runtime_error if a file is not readable or the setups differ.
+void readResultFiles(const std::vector<std::string>& files, size_t n,
+  double maxPerformance, std::vector<ResultRecord>& records,
+  uint32_t& nFeatures, uint32_t& combsUpTo, uint32_t& order);
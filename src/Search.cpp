@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Search.h"
+#include "SearchTask.h"
+
+
+// Sampled models are timed in runs of this many consecutive models, which
+// reuse parts of the previous fit like within a batch
+const size_t M_SAMPLE_RUN_LENGTH = 8;
+// Number of runs per combination size of a pilot run (batchCosts = "pilot")
+const size_t M_PILOT_RUNS = 2;
+
+
+// The estimated cost of a model of each size (see Combination::setSizeCosts())
+template <class Family, class Measure>
+std::vector<double> estimateSizeCosts(const GLM<Family>& Model, uint k) {
+
+  std::vector<double> costs(k + 1, 0.0);
+  for (uint K = 1; K <= k; K++)
+    costs[K] = Model.estimateCost(K, std::is_same<Measure, MSE>::value);
+  return costs;
+}
+
+
+// Times nRuns runs of runLength consecutive models of size K (in the order of
+// Comb) for each combination size K. Each run starts at a random combination
+// of size K, so the models are fitted like within a batch of the search. Sets
+// means[K] and vars[K] to the mean and variance of the seconds per model over
+// the runs. The model is a copy, so that the search does not start from its
+// state.
+template <class Family, class Measure>
+void timeSampledModels(GLM<Family> Model, const Combination& Comb,
+  size_t nRuns, size_t runLength, uint64_t seed, std::vector<double>& means,
+  std::vector<double>& vars) {
+
+  uint N = Comb.getN(), k = Comb.getK();
+  std::mt19937_64 rng(seed);
+  means.assign(k + 1, 0.0);
+  vars.assign(k + 1, 0.0);
+  std::vector<double> secPerModel(nRuns);
+  std::vector<uint> comb;
+
+  for (uint K = 1; K <= k; K++) {
+    for (size_t run = 0; run < nRuns; run++) {
+
+      // A uniformly drawn K-subset of 1, ..., N (Floyd's algorithm)
+      comb.clear();
+      for (uint j = N - K + 1; j <= N; j++) {
+        uint t = std::uniform_int_distribution<uint>(1, j)(rng);
+        bool drawn = std::find(comb.begin(), comb.end(), t) != comb.end();
+        comb.push_back(drawn ? j : t);
+      }
+      std::sort(comb.begin(), comb.end());
+
+      auto start = std::chrono::steady_clock::now();
+      size_t nModels = 0;
+      while (nModels < runLength && comb.size() == K) {
+        Model.setFeatureCombination(comb);
+        Model.fit();
+        Measure::evaluate(Model);
+        nModels++;
+        // In depth-first order, the models of size K follow each other in
+        // lexicographic order, with their extensions in between
+        if (Comb.getOrder() == DEPTH_FIRST) setNextCombination(comb, N);
+        else Comb.next(comb);
+      }
+      secPerModel[run] = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count() / nModels;
+    }
+
+    size_t df = nRuns > 1 ? nRuns - 1 : 1;
+    for (double sec : secPerModel) means[K] += sec / nRuns;
+    for (double sec : secPerModel)
+      vars[K] += (sec - means[K]) * (sec - means[K]) / df;
+  }
+}
+
+
+// The same costs measured by a short pilot run
+template <class Family, class Measure>
+std::vector<double> measureSizeCosts(const GLM<Family>& Model,
+  const Combination& Comb) {
+
+  std::vector<double> means, vars;
+  timeSampledModels<Family, Measure>(Model, Comb, M_PILOT_RUNS,
+    M_SAMPLE_RUN_LENGTH, 1, means, vars);
+
+  // A zero cost would leave the batches unbalanced
+  for (double& mean : means) mean = std::max(mean, 1e-9);
+  return means;
+}
+
+
+// Throws, if a training or test response is not valid for the family
+template <class Family>
+void checkResponse(const DataSet& D, const std::string& family) {
+
+  for (const std::vector<double>* y : {D.yTrain, D.yTest})
+    for (double y_i : *y)
+      if (!Family::validResponse(y_i))
+        throw std::invalid_argument("The response is invalid for family '" +
+          family + "'.");
+}
+
+
+// Times sampled models (see timeSampledModels()) for the runtime estimate
+template <class Family, class Measure>
+void sampleRuntime(const DataSet& D, const Combination& Comb, bool intercept,
+  size_t nRuns, uint64_t seed, RuntimeEstimate& estimate) {
+
+  GLM<Family> Model(D, intercept, -1);
+  Model.allocateWorkspace(Comb.getK());
+
+  timeSampledModels<Family, Measure>(Model, Comb, nRuns, M_SAMPLE_RUN_LENGTH,
+    seed, estimate.secPerModel, estimate.variance);
+  estimate.secPerModel.erase(estimate.secPerModel.begin());
+  estimate.variance.erase(estimate.variance.begin());
+}
+
+
+// Sets up the Gram matrices of the training and test set in D, if linear
+// models are fitted from them (see GramMatrix::worthwhile()). The training
+// Gram matrix can be forced, e.g. for the bounds of pruning.
+void prepareGramMatrices(DataSet& D, std::unique_ptr<GramMatrix>& GramTrain,
+  std::unique_ptr<GramMatrix>& GramTest, const std::string& family,
+  const std::string& performanceMeasure, bool intercept, size_t nCombinations,
+  size_t combsUpTo, bool forceTrain) {
+
+  if (family != "gaussian") return;
+  const arma::mat& X = *D.XTrain;
+  if (forceTrain || GramMatrix::worthwhile(X.n_rows, X.n_cols, nCombinations,
+    combsUpTo)) {
+    GramTrain.reset(new GramMatrix(X, *D.yTrain, intercept));
+    D.GramTrain = GramTrain.get();
+  }
+
+  // Likewise, their test set MSE is computed from the Gram matrix of the test
+  // set, independent of its size
+  const arma::mat& XT = *D.XTest;
+  if (performanceMeasure == "MSE" && !D.noTestSet() &&
+    GramMatrix::worthwhile(XT.n_rows, XT.n_cols, nCombinations, combsUpTo)) {
+    GramTest.reset(new GramMatrix(XT, *D.yTest, intercept));
+    D.GramTest = GramTest.get();
+  }
+}
+
+
+// Fits all models of Comb with the family and performance measure fixed at
+// compile time, and returns the results
+template <class Family, class Measure>
+SearchResult runSearch(const DataSet& D, Combination& Comb,
+  const SearchSetup& setup, const Checkpoint& checkpointSetup,
+  const Checkpoint* resumed) {
+
+  // Initialize the modelling task object
+  GLM<Family> Model(D, setup.intercept, setup.errorVal);
+  Model.allocateWorkspace(setup.combsUpTo);
+  GLM<Family>* ModelPtr = &Model;
+  Combination* CombPtr = &Comb;
+
+  // Balance the batches by the cost of the models instead of their number. A
+  // resumed search needs exactly the batches of its checkpoint.
+  if (resumed != NULL) {
+    if (!resumed->sizeCosts.empty()) Comb.setSizeCosts(resumed->sizeCosts);
+  } else if (setup.batchCosts == "fixed") {
+    Comb.setSizeCosts(estimateSizeCosts<Family, Measure>(Model,
+      setup.combsUpTo));
+  } else if (setup.batchCosts == "pilot") {
+    Comb.setSizeCosts(measureSizeCosts<Family, Measure>(Model, Comb));
+  }
+
+  // The SearchTask handles the (multithreaded) execution and saves the results
+  size_t nResults = setup.nResults, nThreads = setup.nThreads;
+  bool quietly = setup.quietly;
+  SearchTask<Family, Measure> ST(ModelPtr, CombPtr, nResults, nThreads,
+    quietly);
+  if (!setup.checkpointFile.empty())
+    ST.enableCheckpoints(checkpointSetup, setup.checkpointFile,
+      setup.checkpointInterval);
+  if (resumed != NULL) ST.resume(*resumed);
+  ST.setBackend(setup.backend);
+  if (setup.pinThreads) ST.enableThreadPinning();
+  if (setup.pruning) ST.enablePruning();
+  if (!setup.resultFile.empty()) ST.enableResultFiles(setup.resultFile);
+  ST.run();
+
+  // The ranking is popped from the worst model to the best
+  SearchResult result;
+  while (!ST.rankingEmpty()) {
+    std::pair<double, std::vector<uint>> top = ST.rankingTop();
+    result.performance.push_back(top.first);
+    result.combinations.push_back(top.second);
+    ST.popRanking();
+  }
+  std::reverse(result.performance.begin(), result.performance.end());
+  std::reverse(result.combinations.begin(), result.combinations.end());
+
+  result.runtimeSec = ST.getTotalRuntimeSec();
+  result.nModels = ST.getProgress();
+  result.nBatches = Comb.getNBatches();
+  result.batchSizes = Comb.getBatchSizes();
+  result.nThreads = ST.getNThreads();
+  result.nPruned = ST.getNPruned();
+  result.resultFiles = ST.getResultFiles();
+  return result;
+}
+
+
+// Calls f(Family(), Measure()) with the policies (Family.h) of the given names,
+// i.e. instantiates f for all of their combinations, and returns its result
+template <class Family, class Function>
+auto dispatchMeasure(const std::string& performanceMeasure, Function f)
+  -> decltype(f(Family(), AIC())) {
+
+  if (performanceMeasure == "AIC") return f(Family(), AIC());
+  if (performanceMeasure == "MSE") return f(Family(), MSE());
+  throw std::invalid_argument("Unknown family or performance measure.");
+}
+
+template <class Function>
+auto dispatchModel(const std::string& family,
+  const std::string& performanceMeasure, Function f)
+  -> decltype(f(Gaussian(), AIC())) {
+
+  if (family == "gaussian")
+    return dispatchMeasure<Gaussian>(performanceMeasure, f);
+  if (family == "binomial")
+    return dispatchMeasure<Binomial>(performanceMeasure, f);
+  if (family == "poisson")
+    return dispatchMeasure<Poisson>(performanceMeasure, f);
+  if (family == "Gamma")
+    return dispatchMeasure<Gamma>(performanceMeasure, f);
+  throw std::invalid_argument("Unknown family or performance measure.");
+}
+
+// The search loop and the runtime sampling as functions for dispatchModel()
+struct SearchRunner {
+  const DataSet& D;
+  Combination& Comb;
+  const SearchSetup& setup;
+  const Checkpoint& checkpointSetup;
+  const Checkpoint* resumed;
+
+  template <class Family, class Measure>
+  SearchResult operator()(Family, Measure) const {
+    checkResponse<Family>(D, setup.family);
+    return runSearch<Family, Measure>(D, Comb, setup, checkpointSetup,
+      resumed);
+  }
+};
+
+struct RuntimeSampler {
+  const DataSet& D;
+  const Combination& Comb;
+  const SearchSetup& setup;
+  size_t nSamples;
+  uint64_t seed;
+  RuntimeEstimate& estimate;
+
+  template <class Family, class Measure>
+  void operator()(Family, Measure) const {
+    checkResponse<Family>(D, setup.family);
+    sampleRuntime<Family, Measure>(D, Comb, setup.intercept, nSamples, seed,
+      estimate);
+  }
+};
+
+
+// The enumeration order of setup, with the number of all combinations
+Combination orderedCombinations(const arma::mat& X, const SearchSetup& setup) {
+  return Combination(X.n_cols - 1, setup.combsUpTo, 0, setup.order);
+}
+
+
+SearchResult runExhaustiveSearch(const arma::mat& XInput,
+  const std::vector<double>& yInput, const arma::mat& XTestSet,
+  const std::vector<double>& yTestSet, const SearchSetup& searchSetup) {
+
+  SearchSetup setup = searchSetup;
+
+  // The data shall not be copied from now on, so only work with pointers stored
+  // in a DataSet object (DataSet.h) for structure.
+  const arma::mat * X = &XInput;
+  const std::vector<double> * y = &yInput;
+  const arma::mat * XT = &XTestSet;
+  const std::vector<double> * yT = &yTestSet;
+
+  // If a TestSet was specified use it, otherwise repeat the training pointers
+  DataSet D(X, y, XTestSet.n_rows > 0 ? XT : X, XTestSet.n_rows > 0 ? yT : y);
+
+  // If nThreads was not specified, set it to the number of available threads.
+  // OpenMP has its own default, e.g. from OMP_NUM_THREADS.
+  if (setup.nThreads == 0) setup.nThreads = setup.backend == OPENMP ?
+    openMPMaxThreads() : std::thread::hardware_concurrency();
+  if (setup.nThreads == 0) setup.nThreads = 1;
+  setup.rankEnd = std::min(setup.rankEnd,
+    orderedCombinations(XInput, setup).getNCombinations());
+
+  // The setup of the search as identified in a checkpoint
+  Checkpoint checkpointSetup;
+  checkpointSetup.family = setup.family;
+  checkpointSetup.performanceMeasure = setup.performanceMeasure;
+  checkpointSetup.intercept = setup.intercept;
+  checkpointSetup.errorVal = setup.errorVal;
+  uint64_t checksum = dataChecksum(0, XInput.memptr(),
+    XInput.n_rows * XInput.n_cols);
+  checksum = dataChecksum(checksum, yInput.data(), yInput.size());
+  checksum = dataChecksum(checksum, XTestSet.memptr(),
+    XTestSet.n_rows * XTestSet.n_cols);
+  checksum = dataChecksum(checksum, yTestSet.data(), yTestSet.size());
+  checkpointSetup.dataChecksum = checksum;
+  checkpointSetup.nFeatures = XInput.n_cols - 1;
+  checkpointSetup.combsUpTo = setup.combsUpTo;
+  checkpointSetup.order = setup.order;
+  checkpointSetup.nTrain = XInput.n_rows;
+  checkpointSetup.nTest = XTestSet.n_rows;
+  checkpointSetup.nResults = setup.nResults;
+  checkpointSetup.rankStart = setup.rankStart;
+  checkpointSetup.rankEnd = setup.rankEnd;
+
+  // An existing checkpoint is continued, if requested. Its chunks are only
+  // valid if the search space is split in exactly the same way.
+  const std::string& checkpointFile = setup.checkpointFile;
+  Checkpoint resumed;
+  bool resuming = setup.resume && !checkpointFile.empty() &&
+    std::ifstream(checkpointFile.c_str()).good();
+  if (resuming) {
+    resumed.read(checkpointFile);
+    if (!resumed.matches(checkpointSetup)) throw std::runtime_error(
+      "The checkpoint " + checkpointFile +
+      " was written by a search with a different setup.");
+  }
+  // Initialize the Combination Object (ncols - 1 because of the Intercept col).
+  // The combinations are split into many small chunks, which are distributed
+  // dynamically onto the threads. Only the rank range [rankStart, rankEnd) is
+  // evaluated, which allows to split a search into parts.
+  Combination Comb(XInput.n_cols - 1, setup.combsUpTo,
+    resuming ? resumed.nChunks : setup.nThreads * M_CHUNKS_PER_THREAD,
+    setup.order, setup.rankStart, setup.rankEnd);
+  if (Comb.getNBatches() == 0)
+    throw std::invalid_argument("The rank range contains no combinations.");
+  // Result files hold every model, but pruned models are never evaluated
+  if (setup.pruning && !setup.resultFile.empty())
+    throw std::invalid_argument("Pruning cannot write result files.");
+  if (resuming && Comb.getNBatches() != resumed.nChunks)
+    throw std::runtime_error("Checkpoint " + checkpointFile + " is corrupt.");
+
+  // Linear models are fitted from the Gram matrix, which is computed only once.
+  // Pruning always needs it for its bounds.
+  std::unique_ptr<GramMatrix> GramTrain, GramTest;
+  prepareGramMatrices(D, GramTrain, GramTest, setup.family,
+    setup.performanceMeasure, setup.intercept, Comb.getNCombinations(),
+    setup.combsUpTo, setup.pruning);
+
+  // Dispatch once to the search loop of the family and performance measure
+  const Checkpoint* resumedPtr = resuming ? &resumed : NULL;
+  return dispatchModel(setup.family, setup.performanceMeasure,
+    SearchRunner{D, Comb, setup, checkpointSetup, resumedPtr});
+}
+
+
+RuntimeEstimate estimateRuntime(const arma::mat& XInput,
+  const std::vector<double>& yInput, const arma::mat& XTestSet,
+  const std::vector<double>& yTestSet, const SearchSetup& setup,
+  size_t nSamples, uint64_t seed) {
+
+  const arma::mat * X = &XInput;
+  const std::vector<double> * y = &yInput;
+  const arma::mat * XT = &XTestSet;
+  const std::vector<double> * yT = &yTestSet;
+  DataSet D(X, y, XTestSet.n_rows > 0 ? XT : X, XTestSet.n_rows > 0 ? yT : y);
+  Combination Comb = orderedCombinations(XInput, setup);
+
+  // The Gram matrices are part of the runtime of the search
+  RuntimeEstimate estimate;
+  auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<GramMatrix> GramTrain, GramTest;
+  prepareGramMatrices(D, GramTrain, GramTest, setup.family,
+    setup.performanceMeasure, setup.intercept, Comb.getNCombinations(),
+    setup.combsUpTo, false);
+  estimate.setupSec = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+  dispatchModel(setup.family, setup.performanceMeasure,
+    RuntimeSampler{D, Comb, setup, nSamples, seed, estimate});
+  return estimate;
+}
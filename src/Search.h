@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+#include "Combination.h"
+#include "SearchTask.h"
+
+
+// The setup of an exhaustive search. The defaults are those of the R function
+// ExhaustiveSearch().
+struct SearchSetup {
+
+  // 'gaussian', 'binomial', 'poisson' or 'Gamma' (see Family.h)
+  std::string family;
+  // 'AIC' or 'MSE'
+  std::string performanceMeasure;
+  bool intercept;
+  // The maximum number of features per combination
+  uint combsUpTo;
+  size_t nResults;
+  // 0 uses all available threads (for OPENMP as set by OMP_NUM_THREADS)
+  size_t nThreads;
+  ExecutionBackend backend;
+  // Binds the threads to CPUs with a copy of the data per NUMA node
+  bool pinThreads;
+  EnumerationOrder order;
+  // Only the ranks [rankStart, rankEnd) are evaluated. rankEnd is capped at the
+  // number of combinations.
+  size_t rankStart;
+  size_t rankEnd;
+  // Checkpoints are only written if a file is given (see Checkpoint.h)
+  std::string checkpointFile;
+  size_t checkpointInterval;
+  bool resume;
+  bool pruning;
+  // Every model is written to result files, if a base name is given
+  // (see ResultFile.h)
+  std::string resultFile;
+  // 'fixed', 'pilot' or 'count' (see Combination::setSizeCosts())
+  std::string batchCosts;
+  double errorVal;
+  bool quietly;
+
+  SearchSetup() : family("gaussian"), performanceMeasure("AIC"),
+    intercept(true), combsUpTo(1), nResults(5000), nThreads(0),
+    backend(THREADS), pinThreads(false), order(SIZE_FIRST), rankStart(0),
+    rankEnd(SIZE_MAX), checkpointInterval(600), resume(false), pruning(false),
+    batchCosts("fixed"), errorVal(-1), quietly(false) {}
+};
+
+// The outcome of a search
+struct SearchResult {
+
+  // The final ranking, from the best model to the worst
+  std::vector<double> performance;
+  std::vector<std::vector<uint>> combinations;
+
+  size_t runtimeSec;
+  size_t nModels;
+  size_t nBatches;
+  // The number of models per batch (nThreads * M_CHUNKS_PER_THREAD batches)
+  std::vector<size_t> batchSizes;
+  size_t nThreads;
+  size_t nPruned;
+  std::vector<std::string> resultFiles;
+};
+
+// The sampled runtime of a search (see estimateRuntime())
+struct RuntimeEstimate {
+
+  // The seconds per model of each combination size K (at index K - 1) and
+  // their variance between the sampled runs
+  std::vector<double> secPerModel;
+  std::vector<double> variance;
+  // The seconds spent on the setup of the search (Gram matrices)
+  double setupSec;
+};
+
+// Runs an exhaustive search on the design matrix X (with an intercept column
+// 0, see DataSet.h) and the response y. The models are evaluated on XTest and
+// yTest, unless they have no rows. Throws a std::exception on invalid input.
+SearchResult runExhaustiveSearch(const arma::mat& X,
+  const std::vector<double>& y, const arma::mat& XTest,
+  const std::vector<double>& yTest, const SearchSetup& setup);
+
+// Estimates the runtime of the search of setup by timing nSamples runs of a few
+// consecutive models for each combination size
+RuntimeEstimate estimateRuntime(const arma::mat& X,
+  const std::vector<double>& y, const arma::mat& XTest,
+  const std::vector<double>& yTest, const SearchSetup& setup, size_t nSamples,
+  uint64_t seed);
@@ -1,23 +1,186 @@
 
+#include <algorithm>
 #include <chrono>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
 
 #include "SearchTask.h"
 
-SearchTask::SearchTask(GLM*& ModelPtr, Combination*& CombPtr, size_t& nResults,
-  bool& quietly) :
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+bool openMPAvailable() {
+#ifdef _OPENMP
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+size_t openMPMaxThreads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+
+void TopRanking::merge(ranking other) {
+
+  for (; !other.empty(); other.pop()) {
+    if (entries.size() < n || other.top() < entries.top()) {
+      entries.push(other.top());
+      if (entries.size() > n) entries.pop();
+    }
+  }
+}
+
+#ifdef _OPENMP
+#pragma omp declare reduction(mergeTop : TopRanking : \
+  omp_out.merge(omp_in.entries)) initializer(omp_priv = TopRanking(omp_orig.n))
+#endif
+
+
+template <class Family, class Measure>
+SearchTask<Family, Measure>::SearchTask(GLM<Family>*& ModelPtr,
+  Combination*& CombPtr, size_t& nResults, size_t nThreads, bool& quietly) :
   m_ModelPtr(ModelPtr), m_CombPtr(CombPtr), m_nResults(nResults),
-  m_quietly(quietly), m_aborted(false), m_abortedThreads(0), m_progress(0),
-  m_totalIterations(0), m_totalRuntimeSec(0) {
+  m_quietly(quietly),
+  // More threads than chunks would only idle
+  m_scheduler(std::min(nThreads, CombPtr->getNBatches()),
+    CombPtr->getNBatches()),
+  m_threadStates(m_scheduler.getNThreads()),
+  m_threshold(std::numeric_limits<double>::infinity()), m_aborted(false),
+  m_abortedThreads(0), m_finishedThreads(0), m_totalIterations(0),
+  m_totalRuntimeSec(0), m_pruning(false), m_backend(THREADS),
+  m_pinThreads(false),
+  m_chunkDone(CombPtr->getNBatches()),
+  m_checkpointIntervalSec(0), m_resumedProgress(0), m_resumedRuntimeSec(0) {
 
   for(size_t n : CombPtr->getBatchSizes()) m_totalIterations += n;
 }
 
 
-void SearchTask::run() {
+template <class Family, class Measure>
+size_t SearchTask<Family, Measure>::getProgress() {
+
+  size_t progress = 0;
+  for (ThreadState& state : m_threadStates)
+    progress += state.progress.load(std::memory_order_relaxed);
+  return m_resumedProgress + progress;
+}
+
+
+template <class Family, class Measure>
+size_t SearchTask<Family, Measure>::getNPruned() {
+
+  size_t nPruned = 0;
+  for (ThreadState& state : m_threadStates) nPruned += state.nPruned;
+  return nPruned;
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::enablePruning() {
+
+  if (!std::is_same<Measure, AIC>::value)
+    throw std::invalid_argument("Pruning needs the AIC.");
+  if (m_CombPtr->getOrder() != DEPTH_FIRST)
+    throw std::invalid_argument("Pruning needs the depth-first order.");
+  m_pruning = true;
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::enableThreadPinning() {
+
+  m_pinThreads = true;
+  m_topology.reset(new NumaTopology());
+  m_replicas.resize(m_topology->getNNodes());
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::setBackend(ExecutionBackend backend) {
+
+  if (backend == OPENMP && !openMPAvailable())
+    throw std::invalid_argument("This build does not support OpenMP.");
+  m_backend = backend;
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::enableResultFiles(const std::string& base) {
+
+  for (size_t t = 0; t < m_threadStates.size(); t++) {
+    std::string file = base + "." + std::to_string(t);
+    m_threadStates[t].resultWriter.reset(new ResultWriter(file,
+      m_CombPtr->getN(), m_CombPtr->getK(), m_CombPtr->getOrder()));
+    if (m_threadStates[t].resultWriter->failed())
+      throw std::runtime_error("Cannot write result file " + file);
+  }
+}
+
+
+template <class Family, class Measure>
+std::vector<std::string> SearchTask<Family, Measure>::getResultFiles() {
+
+  std::vector<std::string> files;
+  for (ThreadState& state : m_threadStates)
+    if (state.resultWriter) files.push_back(state.resultWriter->getFile());
+  return files;
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::enableCheckpoints(const Checkpoint& setup,
+  const std::string& file, size_t intervalSec) {
+
+  m_checkpointSetup = setup;
+  m_checkpointFile = file;
+  m_checkpointIntervalSec = intervalSec;
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::resume(const Checkpoint& checkpoint) {
+
+  const std::vector<size_t>& sizes = m_CombPtr->getBatchSizes();
+  for (size_t c = 0; c < m_chunkDone.size(); c++) {
+    if (!checkpoint.chunkDone[c]) continue;
+    m_chunkDone[c] = true;
+    m_resumedProgress += sizes[c];
+  }
+  m_scheduler = ChunkScheduler(m_scheduler.getNThreads(), m_chunkDone.size(),
+    checkpoint.chunkDone);
+
+  // The models found so far are the start of the final ranking
+  for (const RankingEntry& entry : checkpoint.entries) {
+    m_result.push(entry);
+    if (m_result.size() > m_nResults) m_result.pop();
+  }
+  if (m_result.size() == m_nResults) publishThreshold(m_result.top().first);
+
+  m_resumedRuntimeSec = checkpoint.runtimeSec;
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::run() {
 
+  // The OpenMP team is started from a single thread, so that the main thread
+  // stays free for the status updates like with the thread backend
   std::vector<std::thread> threads;
-  threads.reserve(m_CombPtr->getNBatches());
-  for (size_t i = 0; i < m_CombPtr->getNBatches(); i++)
+  threads.reserve(m_scheduler.getNThreads());
+  if (m_backend == OPENMP)
+    threads.emplace_back(&SearchTask::openMPComputation, this);
+  else for (size_t i = 0; i < m_scheduler.getNThreads(); i++)
     threads.emplace_back(&SearchTask::threadComputation, this, i);
 
   // The main thread is held in a loop, iteratively printing progress updates
@@ -26,68 +189,252 @@ void SearchTask::run() {
 
   for (std::thread &thread : threads) thread.join();
 
-  if (m_abortedThreads > 0)
+  // The final state allows to resume an interrupted search
+  if (!m_checkpointFile.empty()) writeCheckpoint();
+
+  // Result files are completed, also for an interrupted search
+  for (ThreadState& state : m_threadStates) {
+    if (!state.resultWriter) continue;
+    state.resultWriter->flush();
+    if (state.resultWriter->failed()) throw std::runtime_error(
+      "Cannot write result file " + state.resultWriter->getFile());
+  }
+
+  // The OpenMP loop skips the chunks left after an interrupt without counting
+  // an aborted thread, so unfinished chunks also mark an interrupted search
+  bool allDone = std::all_of(m_chunkDone.begin(), m_chunkDone.end(),
+    [](const std::atomic<bool>& done) { return done.load(); });
+  if (m_abortedThreads > 0 || (m_aborted && !allDone))
     throw std::runtime_error("Execution aborted by the user.");
+
+  mergeResults();
 }
 
 
-void SearchTask::threadComputation(size_t threadID) {
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::threadComputation(size_t threadID) {
 
-  size_t n = m_CombPtr->getN();
+  ThreadState& state = m_threadStates[threadID];
 
-  // Read the start and stop limits of this task.
-  std::vector<uint> currentComb = m_CombPtr->getBatchLimits()[threadID];
-  std::vector<uint> stoppingComb = m_CombPtr->getBatchLimits()[threadID + 1];
+  // Thread creates a copy of the GLM object to fit it without worries. It is
+  // made after the thread is placed, so that its workspace is local memory.
+  const DataSet* localData = placeWorker(threadID);
+  GLM<Family> Model = *m_ModelPtr;
+  if (localData != NULL) Model.setDataSet(*localData);
+  std::vector<uint> currentComb;
+
+  // Process chunks until the scheduler has no work left for this thread
+  size_t chunkID;
+  while (m_scheduler.next(threadID, chunkID))
+    if (!evaluateChunk(chunkID, Model, state, currentComb)) break;
+  m_finishedThreads++;
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::openMPComputation() {
+
+#ifdef _OPENMP
+  // The chunks of a resumed search that are left
+  std::vector<size_t> chunks;
+  for (size_t c = 0; c < m_chunkDone.size(); c++)
+    if (!m_chunkDone[c].load(std::memory_order_relaxed)) chunks.push_back(c);
+  long nChunks = chunks.size();
+
+  // The team may be smaller than requested (e.g. by OMP_THREAD_LIMIT), but
+  // never larger, so each thread has its own state
+#pragma omp parallel num_threads(m_scheduler.getNThreads())
+  {
+    ThreadState& state = m_threadStates[omp_get_thread_num()];
+    const DataSet* localData = placeWorker(omp_get_thread_num());
+    GLM<Family> Model = *m_ModelPtr;
+    if (localData != NULL) Model.setDataSet(*localData);
+    std::vector<uint> currentComb;
+
+    // A loop cannot be left early, after an interrupt the remaining chunks
+    // are skipped
+#pragma omp for schedule(dynamic)
+    for (long i = 0; i < nChunks; i++) {
+      if (m_aborted.load(std::memory_order_relaxed)) continue;
+      evaluateChunk(chunks[i], Model, state, currentComb);
+    }
+  }
+#endif
+  m_finishedThreads = m_scheduler.getNThreads();
+}
 
-  // Thread creates a copy of the GLM object to fit it without worries
-  GLM Model = *m_ModelPtr;
 
-  // Continue, as long as the stopping combination was not evaluated yet
-  while (currentComb != stoppingComb) {
+template <class Family, class Measure>
+const DataSet* SearchTask<Family, Measure>::placeWorker(size_t threadID) {
 
-    // Function is found in Combination.h
-    setNextCombination(currentComb, n);
+  if (!m_pinThreads) return NULL;
+  if (m_backend == THREADS) pinCurrentThread(m_topology->workerCpu(threadID));
+  if (m_replicas.size() < 2) return NULL;
+
+  // The first worker of a node copies the data, while it runs on that node
+  size_t node = m_topology->currentNode();
+  std::lock_guard<std::mutex> lockGuard(m_replicaMutex);
+  if (!m_replicas[node])
+    m_replicas[node].reset(new DataReplica(m_ModelPtr->getDataSet()));
+  return &m_replicas[node]->D;
+}
+
+
+template <class Family, class Measure>
+bool SearchTask<Family, Measure>::evaluateChunk(size_t chunkID,
+  GLM<Family>& Model, ThreadState& state, std::vector<uint>& currentComb) {
+
+  const std::vector<size_t>& starts = m_CombPtr->getBatchStarts();
+  const std::vector<size_t>& sizes = m_CombPtr->getBatchSizes();
+
+  // Jump directly to the first combination of this chunk
+  m_CombPtr->unrank(starts[chunkID], currentComb);
+
+  size_t nSkipped = 0;
+  for (size_t i = 0; i < sizes[chunkID]; i++) {
+
+    // Step through the combinations in the order of m_CombPtr
+    if (nSkipped > 0) setNextSiblingDFS(currentComb, m_CombPtr->getN());
+    else if (i > 0) m_CombPtr->next(currentComb);
 
     // Compute the Model for the current combination
     Model.setFeatureCombination(currentComb);
     Model.fit();
-    double perfResult = Model.getPerformance();
+    double perfResult = Measure::evaluate(Model);
+    uint64_t rank = starts[chunkID] + i;
+    if (state.resultWriter) state.resultWriter->add(rank, perfResult);
+
+    // Only the thread's own ranking is updated, so it can be read without
+    // lock. Models that are worse than the global threshold are rejected
+    // right away, as at least nResults better models were already found.
+    if (perfResult < m_threshold.load(std::memory_order_relaxed) &&
+      (state.result.size() < m_nResults ||
+        perfResult < state.result.top().first)) {
+
+      std::lock_guard<std::mutex> lockGuard(state.resultMutex);
+      state.result.push(std::make_pair(perfResult, rank));
+
+      // Is the queue now too large? -> remove the first element (the worst)
+      if (state.result.size() > m_nResults) state.result.pop();
+
+      // A full ranking defines a new upper bound for the final ranking
+      if (state.result.size() == m_nResults)
+        publishThreshold(state.result.top().first);
+    }
 
-    // This code chunk has a local lock_guard to secure r/w on shared data.
-    // Could this be a possible bottleneck? The alternative would be to build up
-    // separate results per thread and join them afterwards on main thread. This
-    // would remove the shared data, but would need nThreads-times more memory.
-    {
-      std::lock_guard<std::mutex> lockGuard(mtx);
+    // Skipped models count as evaluated
+    nSkipped = m_pruning ?
+      pruneExtensions(Model, currentComb, sizes[chunkID] - i - 1) : 0;
+    i += nSkipped;
+    state.nPruned += nSkipped;
+    state.progress.fetch_add(1 + nSkipped, std::memory_order_relaxed);
 
-      if (m_result.size() < m_nResults || perfResult < m_result.top().first) {
+    // Check for user interrupts
+    if (m_aborted.load(std::memory_order_relaxed)) {
+      m_abortedThreads++;
+      return false;
+    }
+  }
+  m_chunkDone[chunkID].store(true, std::memory_order_release);
+  return true;
+}
 
-        m_result.push(std::make_pair(perfResult, currentComb));
 
-        // Is the queue now too large? -> remove the first element (the worst)
-        if (m_result.size() > m_nResults) m_result.pop();
-      }
-      m_progress++;
+template <class Family, class Measure>
+size_t SearchTask<Family, Measure>::pruneExtensions(GLM<Family>& Model,
+  const std::vector<uint>& comb, size_t maxSkip) {
 
-      // Check for user interrupts
-      if (m_aborted) {
-        m_abortedThreads++;
-        break;
-      }
+  size_t k = m_CombPtr->getK();
+  if (comb.size() >= k || maxSkip == 0) return 0;
+  double threshold = m_threshold.load(std::memory_order_relaxed);
+  if (threshold == std::numeric_limits<double>::infinity()) return 0;
+
+  // The bound costs about t (|comb| + t)^2 operations for the t features after
+  // the last one of comb. It is only computed if this is small compared to
+  // fitting all extensions.
+  size_t nExtensions = m_CombPtr->nExtensions(comb);
+  double t = m_CombPtr->getN() - comb.back();
+  double dim = comb.size() + 1 + t;
+  if (t * dim * dim > (double)nExtensions * (k + 1) * (k + 1)) return 0;
+
+  if (Model.getAICBoundOfExtensions() < threshold) return 0;
+  return std::min(nExtensions, maxSkip);
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::publishThreshold(double threshold) {
+
+  // Atomic minimum: retry until the stored value is at most threshold
+  double current = m_threshold.load(std::memory_order_relaxed);
+  while (threshold < current && !m_threshold.compare_exchange_weak(current,
+    threshold, std::memory_order_relaxed));
+}
+
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::mergeResults() {
+
+  // Combine all per-thread rankings into the final one of size nResults. With
+  // OpenMP, this is a parallel reduction over the threads.
+  TopRanking merged(m_nResults);
+  merged.entries.swap(m_result);
+  long nStates = m_threadStates.size();
+#ifdef _OPENMP
+#pragma omp parallel for reduction(mergeTop : merged) if (m_backend == OPENMP) \
+  num_threads(m_scheduler.getNThreads())
+#endif
+  for (long t = 0; t < nStates; t++) {
+    merged.merge(m_threadStates[t].result);
+    m_threadStates[t].result = ranking();
+  }
+  m_result.swap(merged.entries);
+}
 
-      // allows trackStatus() to run every once in a while
-      if (m_progress % M_NOTIFY_INTERVAL == 0) condVar.notify_one();
+
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::writeCheckpoint() {
+
+  Checkpoint checkpoint = m_checkpointSetup;
+  checkpoint.nChunks = m_chunkDone.size();
+  checkpoint.sizeCosts = m_CombPtr->getSizeCosts();
+  checkpoint.runtimeSec = getTotalRuntimeSec();
+  checkpoint.chunkDone.resize(m_chunkDone.size());
+  for (size_t c = 0; c < m_chunkDone.size(); c++)
+    checkpoint.chunkDone[c] = m_chunkDone[c].load(std::memory_order_acquire);
+
+  // The chunks were read first, so all models of completed chunks, which are
+  // still in a ranking, are part of the copies
+  std::vector<ranking> copies(1, m_result);
+  for (ThreadState& state : m_threadStates) {
+    std::lock_guard<std::mutex> lockGuard(state.resultMutex);
+    copies.push_back(state.result);
+  }
+
+  const std::vector<size_t>& starts = m_CombPtr->getBatchStarts();
+  for (ranking& copy : copies) {
+    for (; !copy.empty(); copy.pop()) {
+      size_t chunk = std::upper_bound(starts.begin(), starts.end(),
+        copy.top().second) - starts.begin() - 1;
+      if (checkpoint.chunkDone[chunk]) checkpoint.entries.push_back(copy.top());
     }
   }
-  // If the function ends, trackStatus() may run
-  condVar.notify_one();
+
+  // Only the best nResults models are needed
+  std::sort(checkpoint.entries.begin(), checkpoint.entries.end());
+  if (checkpoint.entries.size() > m_nResults)
+    checkpoint.entries.resize(m_nResults);
+
+  checkpoint.write(m_checkpointFile);
 }
 
 
-void SearchTask::trackStatus() {
+template <class Family, class Measure>
+void SearchTask<Family, Measure>::trackStatus() {
 
   auto startTime = std::chrono::high_resolution_clock::now();
   auto timeLastPrint = startTime;
+  auto timeLastCheckpoint = startTime;
   size_t elapsedTimeSec = 0;
 
   // The number of digits m_totalIterations has (used for formatting)
@@ -96,44 +443,59 @@ void SearchTask::trackStatus() {
 
   // Print the output header
   if (!m_quietly) {
-    Rcpp::Rcout << " Runtime          |  Completed"
-    << std::string(2 * (m_dig - 4), ' ') << "  |  Status\n"
+    consoleOut() << " Runtime          |  Completed"
+    << std::string(m_dig > 4 ? 2 * (m_dig - 4) : 0, ' ') << "  |  Status\n"
     << std::string(34 + 2 * m_dig, '-') << std::endl;
   }
 
-  std::unique_lock<std::mutex> lock(mtx);
-  while (m_progress < m_totalIterations) {
+  bool finished = false;
+  while (!finished) {
 
-    // Wait for a thread to allow a run
-    condVar.wait(lock);
+    // Give the threads some time to make progress
+    std::this_thread::sleep_for(std::chrono::milliseconds(M_POLL_INTERVAL_MS));
+    finished = m_finishedThreads == m_scheduler.getNThreads();
+    size_t progress = getProgress();
+
+    m_totalRuntimeSec = (size_t)((std::chrono::duration<float>)(
+      std::chrono::high_resolution_clock::now() - startTime)).count();
 
     // Check for user interrupts
-    if (checkInterrupt()) {
+    if (userInterrupted()) {
       m_aborted = true;
       return;
     }
 
+    // Periodically save the state of the search. A failed write does not stop
+    // the search, the next attempt may succeed.
+    if (!m_checkpointFile.empty() && !finished && (size_t)((std::chrono::
+      duration<float>)(std::chrono::high_resolution_clock::now() -
+        timeLastCheckpoint)).count() >= m_checkpointIntervalSec) {
+      try {
+        writeCheckpoint();
+      } catch (std::exception& e) {
+        consoleErr() << "Warning: " << e.what() << std::endl;
+      }
+      timeLastCheckpoint = std::chrono::high_resolution_clock::now();
+    }
+
     if (!m_quietly) {
-      m_totalRuntimeSec = (size_t)((std::chrono::duration<float>)(
-        std::chrono::high_resolution_clock::now() - startTime)).count();
       // Have enough seconds passed for an update to the console?
       elapsedTimeSec = (size_t)((std::chrono::duration<float>)(
         std::chrono::high_resolution_clock::now() - timeLastPrint)).count();
-      if (elapsedTimeSec >= M_PRINT_INTERVAL_SEC ||
-        m_progress == m_totalIterations) {
+      if (elapsedTimeSec >= M_PRINT_INTERVAL_SEC || finished) {
         // Format into (dd:hh:mm:ss)
         uint days = m_totalRuntimeSec / 60 / 60 / 24;
         uint hour = (m_totalRuntimeSec / 60 / 60) % 24;
         uint min = (m_totalRuntimeSec / 60) % 60;
         uint sec = m_totalRuntimeSec % 60;
 
-        Rcpp::Rcout << " "
+        consoleOut() << " "
         << std::setw(2) << std::setfill('0') << days << "d "
         << std::setw(2) << std::setfill('0') << hour << "h "
         << std::setw(2) << std::setfill('0') << min << "m "
         << std::setw(2) << std::setfill('0') << sec << "s  |  "
-        << std::setw(m_dig) << m_progress << "/" << m_totalIterations << "  |  "
-        << (uint)(100 * m_progress / m_totalIterations) << "%" << std::endl;
+        << std::setw(m_dig) << progress << "/" << m_totalIterations << "  |  "
+        << (uint)(100 * progress / m_totalIterations) << "%" << std::endl;
 
         timeLastPrint = std::chrono::high_resolution_clock::now();
       }
@@ -144,5 +506,16 @@ void SearchTask::trackStatus() {
     std::chrono::high_resolution_clock::now() - startTime)).count();
 
   // Print the output footer
-  if (!m_quietly) Rcpp::Rcout << std::string(34 + 2 * m_dig, '-') << std::endl;
+  if (!m_quietly)
+    consoleOut() << std::string(34 + 2 * m_dig, '-') << std::endl;
 }
+
+
+template class SearchTask<Gaussian, AIC>;
+template class SearchTask<Gaussian, MSE>;
+template class SearchTask<Binomial, AIC>;
+template class SearchTask<Binomial, MSE>;
+template class SearchTask<Poisson, AIC>;
+template class SearchTask<Poisson, MSE>;
+template class SearchTask<Gamma, AIC>;
+template class SearchTask<Gamma, MSE>;
@@ -1,58 +1,185 @@
+#pragma once
 
 #include <thread>
 #include <queue>
+#include <atomic>
+#include <memory>
 #include <mutex>
-#include <condition_variable>
+#include <string>
 
 #include "GLM.h"
 #include "Combination.h"
-
-
-typedef std::priority_queue<std::pair<double, std::vector<uint>>> ranking;
-
-const size_t M_NOTIFY_INTERVAL = 100;
+#include "ChunkScheduler.h"
+#include "Checkpoint.h"
+#include "ResultFile.h"
+#include "Numa.h"
+
+
+// A ranking entry holds the performance of a model and the rank of its
+// combination (Combination::rank()). Combinations are only decoded for the
+// final ranking, so entries have a fixed width and the heaps never allocate
+// memory per model.
+typedef std::pair<double, uint64_t> RankingEntry;
+typedef std::priority_queue<RankingEntry> ranking;
+
+// The execution backend of a search:
+// - THREADS: one std::thread per worker, which take their chunks from a
+//   work-stealing ChunkScheduler
+// - OPENMP: an OpenMP parallel loop over the chunks with a dynamic schedule.
+//   The number of threads and their placement follow the OpenMP environment
+//   (OMP_NUM_THREADS, OMP_PROC_BIND, OMP_PLACES).
+enum ExecutionBackend { THREADS, OPENMP };
+
+// True if the package was compiled with OpenMP support
+bool openMPAvailable();
+// The number of threads an OpenMP parallel region uses by default
+size_t openMPMaxThreads();
+
+// Interval in which the main thread checks for interrupts and progress
+const size_t M_POLL_INTERVAL_MS = 50;
 const size_t M_PRINT_INTERVAL_SEC = 5;
+// The search space is split into this many chunks per thread, which are then
+// distributed dynamically (ChunkScheduler.h)
+const size_t M_CHUNKS_PER_THREAD = 64;
+
+// Everything a single thread writes during the search. Each thread builds up
+// its own ranking, whose lock is only contended while the main thread copies it
+// for a checkpoint. The progress counter is read by the main thread. The
+// alignment puts each state in its own cache line.
+struct alignas(64) ThreadState {
+  ranking result;
+  std::mutex resultMutex;
+  std::atomic<size_t> progress;
+  // Number of models skipped by pruning (included in progress)
+  size_t nPruned;
+  // Receives every evaluated model, if result files are enabled
+  std::unique_ptr<ResultWriter> resultWriter;
+  ThreadState() : progress(0), nPruned(0) {}
+};
+
+// The best entries of several rankings. This is the type of the top-K reduction
+// of the OpenMP backend, in which each thread merges some rankings into its
+// own TopRanking, which are then merged with each other.
+struct TopRanking {
+  ranking entries;
+  size_t n;
+  explicit TopRanking(size_t n = 0) : n(n) {}
+  // Keeps the best n of the entries and those of other
+  void merge(ranking other);
+};
 
+// The SearchTask is specialized for the model family and performance measure
+// (Family.h), so that the evaluation loop has no runtime dispatch.
+template <class Family, class Measure>
 class SearchTask {
 
   // Input
-  GLM* m_ModelPtr;
+  GLM<Family>* m_ModelPtr;
   Combination* m_CombPtr;
   size_t m_nResults;
   bool m_quietly;
 
   // Execution
-  std::mutex mtx;
-  std::condition_variable condVar;
-  bool m_aborted;
-  size_t m_abortedThreads;
-  size_t m_progress;
+  ChunkScheduler m_scheduler;
+  std::vector<ThreadState> m_threadStates;
+  // The worst performance that can still enter the final ranking. It is the
+  // minimum over the worst entries of all full per-thread rankings.
+  std::atomic<double> m_threshold;
+  std::atomic<bool> m_aborted;
+  std::atomic<size_t> m_abortedThreads;
+  std::atomic<size_t> m_finishedThreads;
   size_t m_totalIterations;
   size_t m_totalRuntimeSec;
+  bool m_pruning;
+  ExecutionBackend m_backend;
+
+  // Thread placement. With more than one NUMA node, the workers of each node
+  // read their own copy of the data, which is created on first use.
+  bool m_pinThreads;
+  std::unique_ptr<NumaTopology> m_topology;
+  std::vector<std::unique_ptr<DataReplica>> m_replicas;
+  std::mutex m_replicaMutex;
+
+  // Checkpoints. A chunk is marked done once all its models are evaluated.
+  std::vector<std::atomic<bool>> m_chunkDone;
+  Checkpoint m_checkpointSetup;
+  std::string m_checkpointFile;
+  size_t m_checkpointIntervalSec;
+  size_t m_resumedProgress;
+  size_t m_resumedRuntimeSec;
 
   // Output
   ranking m_result;
 
-
+  void publishThreshold(double threshold);
+  void mergeResults();
+  // Collects the models of all completed chunks and writes them to the
+  // checkpoint file. Models of unfinished chunks are left out, as these chunks
+  // are evaluated again when the search is resumed.
+  void writeCheckpoint();
+  // Pins the calling worker to its CPU (only for the thread backend) and
+  // returns the data of its NUMA node, or NULL to use the original data.
+  const DataSet* placeWorker(size_t threadID);
+  // Evaluates all models of a chunk. Returns false, if the search was
+  // interrupted before the chunk was completed.
+  bool evaluateChunk(size_t chunkID, GLM<Family>& Model, ThreadState& state,
+    std::vector<uint>& comb);
+  // Returns the number of models following comb that are skipped, because
+  // none of its extensions can enter the ranking (at most maxSkip)
+  size_t pruneExtensions(GLM<Family>& Model, const std::vector<uint>& comb,
+    size_t maxSkip);
 
 public:
-  SearchTask(GLM*& ModelPtr, Combination*& CombPtr, size_t& nResults,
-    bool& quietly);
+  SearchTask(GLM<Family>*& ModelPtr, Combination*& CombPtr, size_t& nResults,
+    size_t nThreads, bool& quietly);
 
-  size_t getProgress() { return m_progress; }
+  size_t getProgress();
   void popRanking() { m_result.pop(); }
   bool rankingEmpty() { return m_result.empty(); }
-  std::pair<double, std::vector<uint>> rankingTop() { return m_result.top(); }
-  size_t getTotalRuntimeSec() { return m_totalRuntimeSec; }
+  std::pair<double, std::vector<uint>> rankingTop() {
+    return std::make_pair(m_result.top().first,
+      m_CombPtr->unrank(m_result.top().second));
+  }
+  size_t getTotalRuntimeSec() {
+    return m_resumedRuntimeSec + m_totalRuntimeSec;
+  }
+  size_t getNThreads() { return m_scheduler.getNThreads(); }
+  size_t getNPruned();
+
+  // Branch and bound: Subtrees of the depth-first order whose AIC bound
+  // (GLM::getAICBoundOfExtensions()) is not below the current threshold are
+  // skipped. The ranking stays the same, but only the subtrees within a chunk
+  // can be skipped. Only for the AIC in depth-first order, without a Gram
+  // matrix nothing is pruned.
+  void enablePruning();
+
+  // Writes the rank and performance of every evaluated model to the files
+  // base.0, base.1, ... (one per thread, see ResultFile.h)
+  void enableResultFiles(const std::string& base);
+  std::vector<std::string> getResultFiles();
+
+  // Writes a checkpoint (with the setup fields of setup) to file every
+  // intervalSec seconds, when the search is interrupted and when it is done.
+  void enableCheckpoints(const Checkpoint& setup, const std::string& file,
+    size_t intervalSec);
+  // Continues the search of a checkpoint. Its completed chunks are skipped and
+  // its models are part of the ranking. Needs to be called before run().
+  void resume(const Checkpoint& checkpoint);
+
+  // Binds each worker thread to a CPU, alternating between the NUMA nodes.
+  // On machines with several nodes, each node gets a copy of the data. With
+  // OPENMP, the placement is left to OpenMP (OMP_PROC_BIND) and only the copies
+  // are used.
+  void enableThreadPinning();
+
+  // Selects the execution backend (THREADS by default). Throws a
+  // std::invalid_argument for OPENMP, if OpenMP is not available.
+  void setBackend(ExecutionBackend backend);
 
   void run();
   void threadComputation(size_t threadID);
+  // The OpenMP backend: all workers in a single parallel loop
+  void openMPComputation();
   void trackStatus();
 
-  // User interrupt checks that are ensured to be Toplevel
-  static void chkIntFn(void *dummy) { R_CheckUserInterrupt(); }
-  inline bool checkInterrupt() {
-    return (R_ToplevelExec(chkIntFn, NULL) == FALSE);
-  }
-
 };
@@ -0,0 +1,351 @@
+#include <math.h>
+#include <string.h>
+
+#include "SimdKernels.h"
+
+#if !defined(ES_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && \
+  (defined(__GNUC__) || defined(__clang__))
+#define ES_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+// Scalar kernels
+
+// The logistic terms of a single observation. With t = exp(-|eta|), which
+// cannot overflow, log(1 + exp(eta)) = max(eta, 0) + log1p(t) and the mean is
+// 1 / (1 + t) or t / (1 + t).
+static inline double logisticTerm(double eta, double y, double& mu) {
+
+  double t = exp(-fabs(eta));
+  double inv = 1.0 / (1.0 + t);
+  mu = eta >= 0 ? inv : t * inv;
+  return (eta > 0 ? eta : 0.0) + log1p(t) - y * eta;
+}
+
+static double logisticBlockScalar(const double* eta, const double* y,
+  size_t len, double* resid, double* weight) {
+
+  double nll = 0.0;
+  for (size_t i = 0; i < len; i++) {
+    double mu;
+    nll += logisticTerm(eta[i], y[i], mu);
+    resid[i] = y[i] - mu;
+    if (weight != NULL) weight[i] = mu * (1.0 - mu);
+  }
+  return nll;
+}
+
+static double dotProductScalar(const double* a, const double* b, size_t len) {
+
+  double s = 0.0;
+  for (size_t i = 0; i < len; i++) s += a[i] * b[i];
+  return s;
+}
+
+static void axpyScalar(double alpha, const double* x, double* y, size_t len) {
+  for (size_t i = 0; i < len; i++) y[i] += alpha * x[i];
+}
+
+
+#ifdef ES_X86_SIMD
+
+// exp(x) for x in [-708, 0] is 2^n * exp(r) with n = round(x / log(2)) and
+// |r| <= log(2) / 2, where the Taylor series of exp(r) up to r^13 is accurate
+// to double precision. The integer n is read from the low bits of the mantissa
+// after adding M_ROUND, and 2^n is built from its exponent bits.
+static const double M_EXP_MIN = -708.0;
+static const double M_ROUND = 6755399441055744.0;  // 1.5 * 2^52
+static const double M_LN2_HI = 6.93147180369123816490e-01;
+static const double M_LN2_LO = 1.90821492927058770002e-10;
+static const double M_EXP_COEF[14] = {
+  1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0,
+  1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0,
+  1.0 / 24.0, 1.0 / 6.0, 1.0 / 2.0, 1.0, 1.0};
+// log(f) for f in [1, sqrt(2)] is 2 * atanh(s) with s = (f - 1) / (f + 1) in
+// [0, 0.172], i.e. s times a polynomial in s^2 with the coefficients
+// 2 / (2m + 1) up to m = 11. For log1p(t), u = 1 + t is rounded, which is
+// corrected by (t - (u - 1)) / u.
+static const double M_LOG_COEF[12] = {
+  2.0 / 23, 2.0 / 21, 2.0 / 19, 2.0 / 17, 2.0 / 15, 2.0 / 13, 2.0 / 11,
+  2.0 / 9, 2.0 / 7, 2.0 / 5, 2.0 / 3, 2.0};
+
+
+// AVX2 with FMA, 4 rows per instruction
+
+#define ES_AVX2 __attribute__((target("avx2,fma")))
+
+ES_AVX2 static inline __m256d expAvx2(__m256d x) {
+
+  x = _mm256_max_pd(x, _mm256_set1_pd(M_EXP_MIN));
+  __m256d k = _mm256_fmadd_pd(x, _mm256_set1_pd(M_LOG2E),
+    _mm256_set1_pd(M_ROUND));
+  __m256d n = _mm256_sub_pd(k, _mm256_set1_pd(M_ROUND));
+  __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(M_LN2_HI), x);
+  r = _mm256_fnmadd_pd(n, _mm256_set1_pd(M_LN2_LO), r);
+
+  __m256d p = _mm256_set1_pd(M_EXP_COEF[0]);
+  for (int c = 1; c < 14; c++)
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(M_EXP_COEF[c]));
+
+  __m256i bits = _mm256_add_epi64(_mm256_slli_epi64(_mm256_castpd_si256(k), 52),
+    _mm256_set1_epi64x(1023LL << 52));
+  return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+}
+
+// log1p(t) for t in [0, 1]
+ES_AVX2 static inline __m256d log1pAvx2(__m256d t) {
+
+  const __m256d one = _mm256_set1_pd(1.0);
+  __m256d u = _mm256_add_pd(one, t);
+  __m256d corr = _mm256_div_pd(_mm256_sub_pd(t, _mm256_sub_pd(u, one)), u);
+
+  __m256d big = _mm256_cmp_pd(u, _mm256_set1_pd(M_SQRT2), _CMP_GT_OQ);
+  __m256d f = _mm256_blendv_pd(u, _mm256_mul_pd(u, _mm256_set1_pd(0.5)), big);
+  __m256d s = _mm256_div_pd(_mm256_sub_pd(f, one), _mm256_add_pd(f, one));
+  __m256d s2 = _mm256_mul_pd(s, s);
+
+  __m256d p = _mm256_set1_pd(M_LOG_COEF[0]);
+  for (int c = 1; c < 12; c++)
+    p = _mm256_fmadd_pd(p, s2, _mm256_set1_pd(M_LOG_COEF[c]));
+
+  __m256d logU = _mm256_fmadd_pd(p, s,
+    _mm256_and_pd(big, _mm256_set1_pd(M_LN2)));
+  return _mm256_add_pd(logU, corr);
+}
+
+ES_AVX2 static inline double sumAvx2(__m256d v) {
+
+  __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),
+    _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+ES_AVX2 static double logisticBlockAvx2(const double* eta, const double* y,
+  size_t len, double* resid, double* weight) {
+
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  __m256d nll = zero;
+
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m256d e = _mm256_loadu_pd(eta + i);
+    __m256d yv = _mm256_loadu_pd(y + i);
+
+    __m256d t = expAvx2(_mm256_or_pd(e, signMask));
+    __m256d inv = _mm256_div_pd(one, _mm256_add_pd(one, t));
+    __m256d mu = _mm256_blendv_pd(_mm256_mul_pd(t, inv), inv,
+      _mm256_cmp_pd(e, zero, _CMP_GE_OQ));
+
+    __m256d term = _mm256_add_pd(_mm256_max_pd(e, zero), log1pAvx2(t));
+    nll = _mm256_add_pd(nll, _mm256_fnmadd_pd(yv, e, term));
+
+    _mm256_storeu_pd(resid + i, _mm256_sub_pd(yv, mu));
+    if (weight != NULL)
+      _mm256_storeu_pd(weight + i, _mm256_mul_pd(mu, _mm256_sub_pd(one, mu)));
+  }
+
+  double sum = sumAvx2(nll);
+  if (i < len)
+    sum += logisticBlockScalar(eta + i, y + i, len - i, resid + i,
+      weight != NULL ? weight + i : NULL);
+  return sum;
+}
+
+ES_AVX2 static double dotProductAvx2(const double* a, const double* b,
+  size_t len) {
+
+  // Two accumulators hide the latency of the FMA
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4),
+      _mm256_loadu_pd(b + i + 4), s1);
+  }
+  if (i + 4 <= len) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+    i += 4;
+  }
+  return sumAvx2(_mm256_add_pd(s0, s1)) + dotProductScalar(a + i, b + i,
+    len - i);
+}
+
+ES_AVX2 static void axpyAvx2(double alpha, const double* x, double* y,
+  size_t len) {
+
+  __m256d a = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4)
+    _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i),
+      _mm256_loadu_pd(y + i)));
+  axpyScalar(alpha, x + i, y + i, len - i);
+}
+
+
+// AVX-512, 8 rows per instruction, with the same approximations as above. The
+// zero-masked forms of some intrinsics avoid false warnings of GCC 12 about
+// their undefined pass-through operand.
+
+#define ES_AVX512 __attribute__((target("avx512f")))
+
+ES_AVX512 static inline double sumAvx512(__m512d v) {
+
+  double lanes[8];
+  _mm512_storeu_pd(lanes, v);
+  return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) +
+    ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+}
+
+ES_AVX512 static inline __m512d expAvx512(__m512d x) {
+
+  x = _mm512_maskz_max_pd(0xFF, x, _mm512_set1_pd(M_EXP_MIN));
+  __m512d k = _mm512_fmadd_pd(x, _mm512_set1_pd(M_LOG2E),
+    _mm512_set1_pd(M_ROUND));
+  __m512d n = _mm512_sub_pd(k, _mm512_set1_pd(M_ROUND));
+  __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(M_LN2_HI), x);
+  r = _mm512_fnmadd_pd(n, _mm512_set1_pd(M_LN2_LO), r);
+
+  __m512d p = _mm512_set1_pd(M_EXP_COEF[0]);
+  for (int c = 1; c < 14; c++)
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(M_EXP_COEF[c]));
+
+  __m512i bits = _mm512_add_epi64(
+    _mm512_maskz_slli_epi64(0xFF, _mm512_castpd_si512(k), 52),
+    _mm512_set1_epi64(1023LL << 52));
+  return _mm512_mul_pd(p, _mm512_castsi512_pd(bits));
+}
+
+ES_AVX512 static inline __m512d log1pAvx512(__m512d t) {
+
+  const __m512d one = _mm512_set1_pd(1.0);
+  __m512d u = _mm512_add_pd(one, t);
+  __m512d corr = _mm512_div_pd(_mm512_sub_pd(t, _mm512_sub_pd(u, one)), u);
+
+  __mmask8 big = _mm512_cmp_pd_mask(u, _mm512_set1_pd(M_SQRT2), _CMP_GT_OQ);
+  __m512d f = _mm512_mask_mul_pd(u, big, u, _mm512_set1_pd(0.5));
+  __m512d s = _mm512_div_pd(_mm512_sub_pd(f, one), _mm512_add_pd(f, one));
+  __m512d s2 = _mm512_mul_pd(s, s);
+
+  __m512d p = _mm512_set1_pd(M_LOG_COEF[0]);
+  for (int c = 1; c < 12; c++)
+    p = _mm512_fmadd_pd(p, s2, _mm512_set1_pd(M_LOG_COEF[c]));
+
+  __m512d ln2 = _mm512_maskz_mov_pd(big, _mm512_set1_pd(M_LN2));
+  return _mm512_add_pd(_mm512_fmadd_pd(p, s, ln2), corr);
+}
+
+ES_AVX512 static double logisticBlockAvx512(const double* eta,
+  const double* y, size_t len, double* resid, double* weight) {
+
+  const __m512d zero = _mm512_setzero_pd();
+  const __m512d one = _mm512_set1_pd(1.0);
+  __m512d nll = zero;
+
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m512d e = _mm512_loadu_pd(eta + i);
+    __m512d yv = _mm512_loadu_pd(y + i);
+
+    __m512d t = expAvx512(_mm512_sub_pd(zero, _mm512_abs_pd(e)));
+    __m512d inv = _mm512_div_pd(one, _mm512_add_pd(one, t));
+    __m512d mu = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(e, zero, _CMP_GE_OQ),
+      _mm512_mul_pd(t, inv), inv);
+
+    __m512d term = _mm512_add_pd(_mm512_maskz_max_pd(0xFF, e, zero),
+      log1pAvx512(t));
+    nll = _mm512_add_pd(nll, _mm512_fnmadd_pd(yv, e, term));
+
+    _mm512_storeu_pd(resid + i, _mm512_sub_pd(yv, mu));
+    if (weight != NULL)
+      _mm512_storeu_pd(weight + i, _mm512_mul_pd(mu, _mm512_sub_pd(one, mu)));
+  }
+
+  double sum = sumAvx512(nll);
+  if (i < len)
+    sum += logisticBlockScalar(eta + i, y + i, len - i, resid + i,
+      weight != NULL ? weight + i : NULL);
+  return sum;
+}
+
+ES_AVX512 static double dotProductAvx512(const double* a, const double* b,
+  size_t len) {
+
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8),
+      _mm512_loadu_pd(b + i + 8), s1);
+  }
+  if (i + 8 <= len) {
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+    i += 8;
+  }
+  return sumAvx512(_mm512_add_pd(s0, s1)) +
+    dotProductScalar(a + i, b + i, len - i);
+}
+
+ES_AVX512 static void axpyAvx512(double alpha, const double* x, double* y,
+  size_t len) {
+
+  __m512d a = _mm512_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8)
+    _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i),
+      _mm512_loadu_pd(y + i)));
+  axpyScalar(alpha, x + i, y + i, len - i);
+}
+
+#endif
+
+
+// Runtime dispatch
+
+struct SimdKernels {
+  const char* name;
+  double (*logisticBlock)(const double*, const double*, size_t, double*,
+    double*);
+  double (*dotProduct)(const double*, const double*, size_t);
+  void (*axpy)(double, const double*, double*, size_t);
+};
+
+static SimdKernels selectKernels() {
+
+#ifdef ES_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    SimdKernels k = {"avx512", logisticBlockAvx512, dotProductAvx512,
+      axpyAvx512};
+    return k;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    SimdKernels k = {"avx2", logisticBlockAvx2, dotProductAvx2, axpyAvx2};
+    return k;
+  }
+#endif
+  SimdKernels k = {"scalar", logisticBlockScalar, dotProductScalar,
+    axpyScalar};
+  return k;
+}
+
+// Selected when the library is loaded, before any search runs
+static const SimdKernels M_KERNELS = selectKernels();
+
+
+double logisticBlock(const double* eta, const double* y, size_t len,
+  double* resid, double* weight) {
+  return M_KERNELS.logisticBlock(eta, y, len, resid, weight);
+}
+
+double dotProduct(const double* a, const double* b, size_t len) {
+  return M_KERNELS.dotProduct(a, b, len);
+}
+
+void axpy(double alpha, const double* x, double* y, size_t len) {
+  M_KERNELS.axpy(alpha, x, y, len);
+}
+
+const char* simdKernelName() { return M_KERNELS.name; }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+
+// Vectorized kernels of the row loops in GLM.cpp. The implementation is chosen
+// once at runtime from the instruction sets of the CPU: AVX-512, AVX2 with FMA,
+// or portable scalar code (which the compiler still vectorizes with SSE2 where
+// it can). Only x86 builds with GCC or Clang have the vector versions, and
+// defining ES_NO_SIMD disables them.
+
+// For the linear predictors eta[0..len-1] of logistic models and the responses
+// y, sets resid[i] = y[i] - mu[i] with mu = 1 / (1 + exp(-eta)), and
+// weight[i] = mu[i] * (1 - mu[i]) unless weight is NULL. Returns the sum of the
+// negLogLiks log(1 + exp(eta)) - y * eta, computed in a numerically stable way.
+// resid may be the same array as eta.
+double logisticBlock(const double* eta, const double* y, size_t len,
+  double* resid, double* weight);
+
+// The sum of a[i] * b[i]
+double dotProduct(const double* a, const double* b, size_t len);
+
+// y[i] += alpha * x[i]
+void axpy(double alpha, const double* x, double* y, size_t len);
+
+// The selected implementation, 'avx512', 'avx2' or 'scalar'
+const char* simdKernelName();
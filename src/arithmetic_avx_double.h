@@ -0,0 +1,273 @@
+/*
+ *      AVX/AVX-512 implementation of vector operations (64bit double), which
+ *      is selected at runtime.
+ *
+ * The operations of arithmetic_sse_double.h serve as the fallback. When the
+ * library is loaded, the CPU is checked for AVX-512F and AVX, and the hot
+ * operations of the two-loop recursion and the line search (vecadd, vecdiff,
+ * vecscale, vecdot and the copies) are then done on 8 or 4 doubles at once.
+ * Like with SSE2, the number of variables is a multiple of 8 and the arrays
+ * are 16-byte aligned, so the wider vectors use unaligned loads and stores,
+ * but need no remainder loop. Requires GCC or Clang on x86.
+ */
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "arithmetic_sse_double.h"
+
+
+/* The SSE2 operations as functions (vecset and vecmul stay SSE2 macros) */
+
+static void veccpy_sse2(lbfgsfloatval_t *y, const lbfgsfloatval_t *x,
+    const int n)
+{
+    veccpy(y, x, n);
+}
+
+static void vecncpy_sse2(lbfgsfloatval_t *y, const lbfgsfloatval_t *x,
+    const int n)
+{
+    vecncpy(y, x, n);
+}
+
+static void vecadd_sse2(lbfgsfloatval_t *y, const lbfgsfloatval_t *x,
+    const lbfgsfloatval_t c, const int n)
+{
+    vecadd(y, x, c, n);
+}
+
+static void vecdiff_sse2(lbfgsfloatval_t *z, const lbfgsfloatval_t *x,
+    const lbfgsfloatval_t *y, const int n)
+{
+    vecdiff(z, x, y, n);
+}
+
+static void vecscale_sse2(lbfgsfloatval_t *y, const lbfgsfloatval_t c,
+    const int n)
+{
+    vecscale(y, c, n);
+}
+
+static void vecdot_sse2(lbfgsfloatval_t *s, const lbfgsfloatval_t *x,
+    const lbfgsfloatval_t *y, const int n)
+{
+    vecdot(s, x, y, n);
+}
+
+#undef veccpy
+#undef vecncpy
+#undef vecadd
+#undef vecdiff
+#undef vecscale
+#undef vecdot
+#undef vec2norm
+#undef vec2norminv
+
+
+/* AVX, 4 doubles per instruction */
+
+#define LBFGS_AVX __attribute__((target("avx")))
+
+LBFGS_AVX static void veccpy_avx(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t *x, const int n)
+{
+    int i;
+    for (i = 0;i < n;i += 8) {
+        _mm256_storeu_pd(y+i  , _mm256_loadu_pd(x+i  ));
+        _mm256_storeu_pd(y+i+4, _mm256_loadu_pd(x+i+4));
+    }
+}
+
+LBFGS_AVX static void vecncpy_avx(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t *x, const int n)
+{
+    int i;
+    __m256d zero = _mm256_setzero_pd();
+    for (i = 0;i < n;i += 8) {
+        _mm256_storeu_pd(y+i  , _mm256_sub_pd(zero, _mm256_loadu_pd(x+i  )));
+        _mm256_storeu_pd(y+i+4, _mm256_sub_pd(zero, _mm256_loadu_pd(x+i+4)));
+    }
+}
+
+LBFGS_AVX static void vecadd_avx(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t *x, const lbfgsfloatval_t c, const int n)
+{
+    int i;
+    __m256d c4 = _mm256_set1_pd(c);
+    for (i = 0;i < n;i += 8) {
+        __m256d x0 = _mm256_mul_pd(_mm256_loadu_pd(x+i  ), c4);
+        __m256d x1 = _mm256_mul_pd(_mm256_loadu_pd(x+i+4), c4);
+        _mm256_storeu_pd(y+i  , _mm256_add_pd(_mm256_loadu_pd(y+i  ), x0));
+        _mm256_storeu_pd(y+i+4, _mm256_add_pd(_mm256_loadu_pd(y+i+4), x1));
+    }
+}
+
+LBFGS_AVX static void vecdiff_avx(lbfgsfloatval_t *z,
+    const lbfgsfloatval_t *x, const lbfgsfloatval_t *y, const int n)
+{
+    int i;
+    for (i = 0;i < n;i += 8) {
+        _mm256_storeu_pd(z+i  ,
+            _mm256_sub_pd(_mm256_loadu_pd(x+i  ), _mm256_loadu_pd(y+i  )));
+        _mm256_storeu_pd(z+i+4,
+            _mm256_sub_pd(_mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4)));
+    }
+}
+
+LBFGS_AVX static void vecscale_avx(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t c, const int n)
+{
+    int i;
+    __m256d c4 = _mm256_set1_pd(c);
+    for (i = 0;i < n;i += 8) {
+        _mm256_storeu_pd(y+i  , _mm256_mul_pd(_mm256_loadu_pd(y+i  ), c4));
+        _mm256_storeu_pd(y+i+4, _mm256_mul_pd(_mm256_loadu_pd(y+i+4), c4));
+    }
+}
+
+LBFGS_AVX static void vecdot_avx(lbfgsfloatval_t *s,
+    const lbfgsfloatval_t *x, const lbfgsfloatval_t *y, const int n)
+{
+    int i;
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    __m128d h;
+    for (i = 0;i < n;i += 8) {
+        s0 = _mm256_add_pd(s0,
+            _mm256_mul_pd(_mm256_loadu_pd(x+i  ), _mm256_loadu_pd(y+i  )));
+        s1 = _mm256_add_pd(s1,
+            _mm256_mul_pd(_mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4)));
+    }
+    s0 = _mm256_add_pd(s0, s1);
+    h = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+    *s = _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+}
+
+
+/* AVX-512, 8 doubles per instruction */
+
+#define LBFGS_AVX512 __attribute__((target("avx512f")))
+
+LBFGS_AVX512 static void veccpy_avx512(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t *x, const int n)
+{
+    int i;
+    for (i = 0;i < n;i += 8) {
+        _mm512_storeu_pd(y+i, _mm512_loadu_pd(x+i));
+    }
+}
+
+LBFGS_AVX512 static void vecncpy_avx512(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t *x, const int n)
+{
+    int i;
+    __m512d zero = _mm512_setzero_pd();
+    for (i = 0;i < n;i += 8) {
+        _mm512_storeu_pd(y+i, _mm512_sub_pd(zero, _mm512_loadu_pd(x+i)));
+    }
+}
+
+LBFGS_AVX512 static void vecadd_avx512(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t *x, const lbfgsfloatval_t c, const int n)
+{
+    int i;
+    __m512d c8 = _mm512_set1_pd(c);
+    for (i = 0;i < n;i += 8) {
+        _mm512_storeu_pd(y+i, _mm512_add_pd(_mm512_loadu_pd(y+i),
+            _mm512_mul_pd(_mm512_loadu_pd(x+i), c8)));
+    }
+}
+
+LBFGS_AVX512 static void vecdiff_avx512(lbfgsfloatval_t *z,
+    const lbfgsfloatval_t *x, const lbfgsfloatval_t *y, const int n)
+{
+    int i;
+    for (i = 0;i < n;i += 8) {
+        _mm512_storeu_pd(z+i,
+            _mm512_sub_pd(_mm512_loadu_pd(x+i), _mm512_loadu_pd(y+i)));
+    }
+}
+
+LBFGS_AVX512 static void vecscale_avx512(lbfgsfloatval_t *y,
+    const lbfgsfloatval_t c, const int n)
+{
+    int i;
+    __m512d c8 = _mm512_set1_pd(c);
+    for (i = 0;i < n;i += 8) {
+        _mm512_storeu_pd(y+i, _mm512_mul_pd(_mm512_loadu_pd(y+i), c8));
+    }
+}
+
+LBFGS_AVX512 static void vecdot_avx512(lbfgsfloatval_t *s,
+    const lbfgsfloatval_t *x, const lbfgsfloatval_t *y, const int n)
+{
+    int i;
+    double lanes[8];
+    __m512d s0 = _mm512_setzero_pd();
+    for (i = 0;i < n;i += 8) {
+        s0 = _mm512_add_pd(s0,
+            _mm512_mul_pd(_mm512_loadu_pd(x+i), _mm512_loadu_pd(y+i)));
+    }
+    _mm512_storeu_pd(lanes, s0);
+    *s = ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) +
+        ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+}
+
+
+/* Runtime dispatch */
+
+struct tag_vector_operations {
+    void (*cpy)(lbfgsfloatval_t*, const lbfgsfloatval_t*, const int);
+    void (*ncpy)(lbfgsfloatval_t*, const lbfgsfloatval_t*, const int);
+    void (*add)(lbfgsfloatval_t*, const lbfgsfloatval_t*,
+        const lbfgsfloatval_t, const int);
+    void (*diff)(lbfgsfloatval_t*, const lbfgsfloatval_t*,
+        const lbfgsfloatval_t*, const int);
+    void (*scale)(lbfgsfloatval_t*, const lbfgsfloatval_t, const int);
+    void (*dot)(lbfgsfloatval_t*, const lbfgsfloatval_t*,
+        const lbfgsfloatval_t*, const int);
+};
+
+static struct tag_vector_operations _vecops = {
+    veccpy_sse2, vecncpy_sse2, vecadd_sse2, vecdiff_sse2, vecscale_sse2,
+    vecdot_sse2
+};
+
+/* Runs when the library is loaded, before any optimization. */
+__attribute__((constructor)) static void select_vector_operations(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        _vecops.cpy = veccpy_avx512;
+        _vecops.ncpy = vecncpy_avx512;
+        _vecops.add = vecadd_avx512;
+        _vecops.diff = vecdiff_avx512;
+        _vecops.scale = vecscale_avx512;
+        _vecops.dot = vecdot_avx512;
+    } else if (__builtin_cpu_supports("avx")) {
+        _vecops.cpy = veccpy_avx;
+        _vecops.ncpy = vecncpy_avx;
+        _vecops.add = vecadd_avx;
+        _vecops.diff = vecdiff_avx;
+        _vecops.scale = vecscale_avx;
+        _vecops.dot = vecdot_avx;
+    }
+}
+
+#define veccpy(y, x, n)         _vecops.cpy((y), (x), (n))
+#define vecncpy(y, x, n)        _vecops.ncpy((y), (x), (n))
+#define vecadd(y, x, c, n)      _vecops.add((y), (x), (c), (n))
+#define vecdiff(z, x, y, n)     _vecops.diff((z), (x), (y), (n))
+#define vecscale(y, c, n)       _vecops.scale((y), (c), (n))
+#define vecdot(s, x, y, n)      _vecops.dot((s), (x), (y), (n))
+#define vec2norm(s, x, n) \
+{ \
+    _vecops.dot((s), (x), (x), (n)); \
+    *(s) = (lbfgsfloatval_t)sqrt(*(s)); \
+}
+#define vec2norminv(s, x, n) \
+{ \
+    vec2norm(s, x, n); \
+    *(s) = (lbfgsfloatval_t)(1.0 / *(s)); \
+}
@@ -41,7 +41,7 @@
 
 inline static void* vecalloc(size_t size)
 {
-#if     defined(_MSC_VER)
+#if     defined(_MSC_VER) || defined(_WIN32)    /* including MinGW */
     void *memblock = _aligned_malloc(size, 16);
 #elif   defined(__APPLE__)  /* OS X always aligns on 16-byte boundaries */
     void *memblock = malloc(size);
@@ -59,7 +59,7 @@ inline static void* vecalloc(size_t size)
 
 inline static void vecfree(void *memblock)
 {
-#ifdef	_MSC_VER
+#if     defined(_MSC_VER) || defined(_WIN32)
     _aligned_free(memblock);
 #else
     free(memblock);
@@ -76,7 +76,12 @@ licence.
 #define inline  __inline
 #endif/*_MSC_VER*/
 
-#if     defined(USE_SSE) && defined(__SSE2__) && LBFGS_FLOAT == 64
+#if     defined(USE_SSE) && defined(__SSE2__) && LBFGS_FLOAT == 64 && \
+        (defined(__GNUC__) || defined(__clang__)) && !defined(ES_NO_SIMD)
+/* Use AVX/AVX-512 if the CPU has it, SSE2 otherwise (selected at runtime). */
+#include "arithmetic_avx_double.h"
+
+#elif   defined(USE_SSE) && defined(__SSE2__) && LBFGS_FLOAT == 64
 /* Use SSE2 optimization for 64bit double precision. */
 #include "arithmetic_sse_double.h"
 
@@ -242,6 +247,42 @@ void lbfgs_parameter_init(lbfgs_parameter_t *param)
     memcpy(param, &_defparam, sizeof(*param));
 }
 
+static int round_out_workspace(int n)
+{
+#if     defined(USE_SSE) && (defined(__SSE__) || defined(__SSE2__))
+    n = round_out_variables(n);
+#endif/*defined(USE_SSE)*/
+    return n;
+}
+
+static int lm_workspace_size(int m)
+{
+    /* The limited memory storage is placed in front of the vectors. */
+    int size = (int)((m * sizeof(iteration_data_t) +
+        sizeof(lbfgsfloatval_t) - 1) / sizeof(lbfgsfloatval_t));
+    return round_out_workspace(size);
+}
+
+int lbfgs_variables_size(int n)
+{
+    return round_out_workspace(n);
+}
+
+int lbfgs_workspace_size(int n, const lbfgs_parameter_t *_param)
+{
+    lbfgs_parameter_t param = (_param != NULL) ? (*_param) : _defparam;
+    int size;
+
+    n = round_out_workspace(n);
+    size = lm_workspace_size(param.m);
+    /* xp, g, gp, d, w, pg and the history pairs s, y. */
+    size += (6 + 2 * param.m) * n;
+    if (0 < param.past) {
+        size += round_out_workspace(param.past);
+    }
+    return size;
+}
+
 int lbfgs(
     int n,
     lbfgsfloatval_t *x,
@@ -251,6 +292,30 @@ int lbfgs(
     void *instance,
     lbfgs_parameter_t *_param
     )
+{
+    int ret;
+    lbfgsfloatval_t *work = (lbfgsfloatval_t*)vecalloc(
+        lbfgs_workspace_size(n, _param) * sizeof(lbfgsfloatval_t));
+
+    if (work == NULL) {
+        return LBFGSERR_OUTOFMEMORY;
+    }
+    ret = lbfgs_ws(
+        n, x, ptr_fx, proc_evaluate, proc_progress, instance, _param, work);
+    vecfree(work);
+    return ret;
+}
+
+int lbfgs_ws(
+    int n,
+    lbfgsfloatval_t *x,
+    lbfgsfloatval_t *ptr_fx,
+    lbfgs_evaluate_t proc_evaluate,
+    lbfgs_progress_t proc_progress,
+    void *instance,
+    lbfgs_parameter_t *_param,
+    lbfgsfloatval_t *work
+    )
 {
     int ret;
     int i, j, k, ls, end, bound;
@@ -363,49 +428,38 @@ int lbfgs(
         }
     }
 
-    /* Allocate working space. */
-    xp = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-    g = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-    gp = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-    d = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-    w = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-    if (xp == NULL || g == NULL || gp == NULL || d == NULL || w == NULL) {
+    /* Carve the working space out of the caller's buffer. */
+    if (work == NULL) {
         ret = LBFGSERR_OUTOFMEMORY;
         goto lbfgs_exit;
     }
+    vecset(work, 0, lbfgs_workspace_size(cd.n, &param));
+    lm = (iteration_data_t*)work;
+    work += lm_workspace_size(m);
+    xp = work; work += n;
+    g = work; work += n;
+    gp = work; work += n;
+    d = work; work += n;
+    w = work; work += n;
 
     if (param.orthantwise_c != 0.) {
-        /* Allocate working space for OW-LQN. */
-        pg = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-        if (pg == NULL) {
-            ret = LBFGSERR_OUTOFMEMORY;
-            goto lbfgs_exit;
-        }
-    }
-
-    /* Allocate limited memory storage. */
-    lm = (iteration_data_t*)vecalloc(m * sizeof(iteration_data_t));
-    if (lm == NULL) {
-        ret = LBFGSERR_OUTOFMEMORY;
-        goto lbfgs_exit;
+        /* Working space for OW-LQN. */
+        pg = work;
     }
+    work += n;
 
     /* Initialize the limited memory. */
     for (i = 0;i < m;++i) {
         it = &lm[i];
         it->alpha = 0;
         it->ys = 0;
-        it->s = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-        it->y = (lbfgsfloatval_t*)vecalloc(n * sizeof(lbfgsfloatval_t));
-        if (it->s == NULL || it->y == NULL) {
-            ret = LBFGSERR_OUTOFMEMORY;
-            goto lbfgs_exit;
-        }
+        it->s = work; work += n;
+        it->y = work; work += n;
     }
 
-    /* Allocate an array for storing previous values of the objective function. */
+    /* An array for storing previous values of the objective function. */
     if (0 < param.past) {
-        pf = (lbfgsfloatval_t*)vecalloc(param.past * sizeof(lbfgsfloatval_t));
+        pf = work;
     }
 
     /* Evaluate the function value and its gradient. */
@@ -620,23 +674,6 @@ lbfgs_exit:
         *ptr_fx = fx;
     }
 
-    vecfree(pf);
-
-    /* Free memory blocks used by this function. */
-    if (lm != NULL) {
-        for (i = 0;i < m;++i) {
-            vecfree(lm[i].s);
-            vecfree(lm[i].y);
-        }
-        vecfree(lm);
-    }
-    vecfree(pg);
-    vecfree(w);
-    vecfree(d);
-    vecfree(gp);
-    vecfree(g);
-    vecfree(xp);
-
     return ret;
 }
 
@@ -484,6 +484,53 @@ int lbfgs(
     lbfgs_parameter_t *param
     );
 
+/**
+ * Start a L-BFGS optimization in a caller-provided working space.
+ *
+ *  This function is equivalent to ::lbfgs, but does not allocate any memory.
+ *  All vectors (including the limited memory storage) are taken from the
+ *  array \c work, which can be reused for any number of optimizations.
+ *
+ *  @param  work        The working space of at least
+ *                      lbfgs_workspace_size(n, param) variables. For libLBFGS
+ *                      built with SSE/SSE2 optimization routines, it must be
+ *                      aligned like an array allocated by ::lbfgs_malloc.
+ *  @retval int         The status code (see ::lbfgs).
+ */
+int lbfgs_ws(
+    int n,
+    lbfgsfloatval_t *x,
+    lbfgsfloatval_t *ptr_fx,
+    lbfgs_evaluate_t proc_evaluate,
+    lbfgs_progress_t proc_progress,
+    void *instance,
+    lbfgs_parameter_t *param,
+    lbfgsfloatval_t *work
+    );
+
+/**
+ * Compute the size of the working space of ::lbfgs_ws.
+ *
+ *  @param  n           The number of variables.
+ *  @param  param       The parameters of the optimization, or \c NULL for the
+ *                      default parameters.
+ *  @retval int         The number of variables (::lbfgsfloatval_t) needed.
+ */
+int lbfgs_workspace_size(int n, const lbfgs_parameter_t *param);
+
+/**
+ * Compute the length of the variable array of ::lbfgs_ws.
+ *
+ *  libLBFGS built with SSE/SSE2 (or the runtime selected AVX) optimization
+ *  routines works on n rounded up to a multiple of 8. The variable array
+ *  \c x then needs this many elements, the ones from n onwards set to zero,
+ *  and the alignment of an array allocated by ::lbfgs_malloc.
+ *
+ *  @param  n           The number of variables.
+ *  @retval int         The number of elements of the variable array.
+ */
+int lbfgs_variables_size(int n);
+
 /**
  * Initialize L-BFGS parameters to the default values.
  *